@@ -28,6 +28,7 @@
 
 #include "directory-view-menu.h"
 #include "file-info.h"
+#include "thumbnail-manager.h"
 
 #include <QMouseEvent>
 
@@ -78,6 +79,12 @@ IconView::IconView(QWidget *parent) : QListView(parent)
     m_renameTimer = new QTimer(this);
     m_renameTimer->setInterval(3000);
     m_editValid = false;
+
+    //do not compute visible items for every scroll step, see scheduleVisibleUrisUpdate().
+    m_visible_uris_timer.setSingleShot(true);
+    m_visible_uris_timer.setInterval(100);
+    connect(&m_visible_uris_timer, &QTimer::timeout, this, &IconView::prioritizeVisibleThumbnails);
+    connect(verticalScrollBar(), &QScrollBar::valueChanged, this, &IconView::scheduleVisibleUrisUpdate);
 }
 
 IconView::~IconView()
@@ -281,6 +288,7 @@ void IconView::resizeEvent(QResizeEvent *e)
     //but I have to reset the index widget in view's resize.
     QListView::resizeEvent(e);
     setIndexWidget(m_last_index, nullptr);
+    scheduleVisibleUrisUpdate();
 }
 
 void IconView::wheelEvent(QWheelEvent *e)
@@ -328,6 +336,10 @@ void IconView::bindModel(FileItemModel *sourceModel, FileItemProxyFilterSortMode
 
     setModel(m_sort_filter_proxy_model);
 
+    connect(m_sort_filter_proxy_model, &FileItemProxyFilterSortModel::rowsInserted, this, &IconView::scheduleVisibleUrisUpdate);
+    connect(m_sort_filter_proxy_model, &FileItemProxyFilterSortModel::layoutChanged, this, &IconView::scheduleVisibleUrisUpdate);
+    connect(m_sort_filter_proxy_model, &FileItemProxyFilterSortModel::modelReset, this, &IconView::scheduleVisibleUrisUpdate);
+
     //edit trigger
     connect(this->selectionModel(), &QItemSelectionModel::selectionChanged, [=](const QItemSelection &selection, const QItemSelection &deselection){
         qDebug()<<"selection changed";
@@ -460,6 +472,41 @@ void IconView::editUris(const QStringList uris)
     //implement batch rename.
 }
 
+void IconView::scheduleVisibleUrisUpdate()
+{
+    if (!m_visible_uris_timer.isActive())
+        m_visible_uris_timer.start();
+}
+
+void IconView::prioritizeVisibleThumbnails()
+{
+    if (!m_sort_filter_proxy_model)
+        return;
+
+    //items are laid out in row order, find the first visible one by binary search.
+    int count = m_sort_filter_proxy_model->rowCount();
+    int low = 0;
+    int high = count;
+    while (low < high) {
+        int mid = (low + high)/2;
+        auto rect = visualRect(m_sort_filter_proxy_model->index(mid, 0));
+        if (rect.bottom() < 0) {
+            low = mid + 1;
+        } else {
+            high = mid;
+        }
+    }
+
+    QStringList uris;
+    for (int row = low; row < count; row++) {
+        auto index = m_sort_filter_proxy_model->index(row, 0);
+        if (visualRect(index).top() > viewport()->height())
+            break;
+        uris<<index.data(FileItemModel::UriRole).toString();
+    }
+    ThumbnailManager::getInstance()->prioritizeVisibleUris(this, uris);
+}
+
 void IconView::clearIndexWidget()
 {
     for (int i = 0; i < m_sort_filter_proxy_model->rowCount(); i++) {
@@ -146,8 +146,29 @@ protected:
 private Q_SLOTS:
     void slotRename();
 
+    /*!
+     * \brief prioritizeVisibleThumbnails
+     * <br>
+     * Tell ThumbnailManager which items are in viewport now, so that
+     * their thumbnails will be generated first.
+     * </br>
+     * \see ThumbnailManager::prioritizeVisibleUris().
+     */
+    void prioritizeVisibleThumbnails();
+
+    /*!
+     * \brief scheduleVisibleUrisUpdate
+     * <br>
+     * Start the timer of prioritizeVisibleThumbnails() if it is not active.
+     * It is not restarted, so the visible items are still updated at a fixed
+     * rate while the view keeps scrolling or the rows keep being inserted.
+     * </br>
+     */
+    void scheduleVisibleUrisUpdate();
+
 private:
     QTimer m_repaint_timer;
+    QTimer m_visible_uris_timer;
 
     bool  m_editValid;
     QTimer* m_renameTimer;
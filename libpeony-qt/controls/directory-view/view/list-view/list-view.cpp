@@ -27,6 +27,7 @@
 #include "list-view-delegate.h"
 
 #include "file-item.h"
+#include "thumbnail-manager.h"
 
 #include <QHeaderView>
 
@@ -68,6 +69,12 @@ ListView::ListView(QWidget *parent) : QTreeView(parent)
     m_renameTimer = new QTimer(this);
     m_renameTimer->setInterval(3000);
     m_editValid = false;
+
+    //do not compute visible items for every scroll step, see scheduleVisibleUrisUpdate().
+    m_visible_uris_timer.setSingleShot(true);
+    m_visible_uris_timer.setInterval(100);
+    connect(&m_visible_uris_timer, &QTimer::timeout, this, &ListView::prioritizeVisibleThumbnails);
+    connect(verticalScrollBar(), &QScrollBar::valueChanged, this, &ListView::scheduleVisibleUrisUpdate);
 }
 
 void ListView::bindModel(FileItemModel *sourceModel, FileItemProxyFilterSortModel *proxyModel)
@@ -81,6 +88,10 @@ void ListView::bindModel(FileItemModel *sourceModel, FileItemProxyFilterSortMode
     //adjust columns layout.
     adjustColumnsSize();
 
+    connect(m_proxy_model, &FileItemProxyFilterSortModel::rowsInserted, this, &ListView::scheduleVisibleUrisUpdate);
+    connect(m_proxy_model, &FileItemProxyFilterSortModel::layoutChanged, this, &ListView::scheduleVisibleUrisUpdate);
+    connect(m_proxy_model, &FileItemProxyFilterSortModel::modelReset, this, &ListView::scheduleVisibleUrisUpdate);
+
     //edit trigger
     connect(this->selectionModel(), &QItemSelectionModel::selectionChanged, [=](const QItemSelection &selection, const QItemSelection &deselection){
         qDebug()<<"selection changed";
@@ -201,6 +212,29 @@ void ListView::resizeEvent(QResizeEvent *e)
 {
     QTreeView::resizeEvent(e);
     adjustColumnsSize();
+    scheduleVisibleUrisUpdate();
+}
+
+void ListView::scheduleVisibleUrisUpdate()
+{
+    if (!m_visible_uris_timer.isActive())
+        m_visible_uris_timer.start();
+}
+
+void ListView::prioritizeVisibleThumbnails()
+{
+    if (!m_proxy_model)
+        return;
+
+    QStringList uris;
+    auto index = indexAt(QPoint(0, 0));
+    while (index.isValid()) {
+        if (visualRect(index).top() > viewport()->height())
+            break;
+        uris<<index.data(FileItemModel::UriRole).toString();
+        index = indexBelow(index);
+    }
+    ThumbnailManager::getInstance()->prioritizeVisibleUris(this, uris);
 }
 
 void ListView::updateGeometries()
@@ -120,6 +120,19 @@ protected:
 
 private Q_SLOTS:
     void slotRename();
+
+    /*!
+     * \brief prioritizeVisibleThumbnails
+     * \see IconView::prioritizeVisibleThumbnails().
+     */
+    void prioritizeVisibleThumbnails();
+
+    /*!
+     * \brief scheduleVisibleUrisUpdate
+     * \see IconView::scheduleVisibleUrisUpdate().
+     */
+    void scheduleVisibleUrisUpdate();
+
 private:
     FileItemModel *m_model = nullptr;
     FileItemProxyFilterSortModel *m_proxy_model = nullptr;
@@ -127,6 +140,8 @@ private:
     QTimer* m_renameTimer;
     bool  m_editValid;
 
+    QTimer m_visible_uris_timer;
+
     QModelIndex m_last_index;
 
     DirectoryViewProxyIface *m_proxy = nullptr;
@@ -284,7 +284,7 @@ void FilePreviewPage::countAsync(const QString &uri)
     auto info = FileInfo::fromUri(uri);
     m_count_op = new FileCountOperation(uris, !info->isDir());
     connect(m_count_op, &FileOperation::operationStarted, this, &FilePreviewPage::resetCount, Qt::BlockingQueuedConnection);
-    connect(m_count_op, &FileOperation::operationPreparedOne, this, &FilePreviewPage::onPreparedOne, Qt::BlockingQueuedConnection);
+    connect(m_count_op, &FileCountOperation::countProgressed, this, &FilePreviewPage::onCountProgressed, Qt::BlockingQueuedConnection);
     connect(m_count_op, &FileCountOperation::countDone, this, &FilePreviewPage::onCountDone, Qt::BlockingQueuedConnection);
     QThreadPool::globalInstance()->start(m_count_op);
 }
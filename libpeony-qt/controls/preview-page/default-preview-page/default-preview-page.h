@@ -95,12 +95,10 @@ private Q_SLOTS:
 
 protected Q_SLOTS:
     void resetCount();
-    void onPreparedOne(const QString &uri, quint64 size) {
-        m_file_count++;
-        if (uri.contains("/.")) {
-            m_hidden_count++;
-        }
-        m_total_size += size;
+    void onCountProgressed(quint64 file_count, quint64 hidden_file_count, quint64 total_size) {
+        m_file_count = file_count;
+        m_hidden_count = hidden_file_count;
+        m_total_size = total_size;
         this->updateCount();
     }
     void onCountDone();
@@ -214,7 +214,7 @@ void BasicPropertiesPage::countFilesAsync(const QStringList &uris)
     m_total_size = 0;
     m_count_op = new FileCountOperation(uris);
     m_count_op->setAutoDelete(true);
-    connect(m_count_op, &FileOperation::operationPreparedOne, this, &BasicPropertiesPage::onFileCountOne, Qt::BlockingQueuedConnection);
+    connect(m_count_op, &FileCountOperation::countProgressed, this, &BasicPropertiesPage::onFileCountProgressed, Qt::BlockingQueuedConnection);
     connect(m_count_op, &FileCountOperation::countDone, [=](quint64 file_count, quint64 hidden_file_count, quint64 total_size){
         m_count_op = nullptr;
         m_file_count = file_count;
@@ -226,13 +226,11 @@ void BasicPropertiesPage::countFilesAsync(const QStringList &uris)
     QThreadPool::globalInstance()->start(m_count_op);
 }
 
-void BasicPropertiesPage::onFileCountOne(const QString &uri, quint64 size)
+void BasicPropertiesPage::onFileCountProgressed(quint64 file_count, quint64 hidden_file_count, quint64 total_size)
 {
-    m_file_count++;
-    if (uri.contains("/.")) {
-        m_hidden_file_count++;
-    }
-    m_total_size += size;
+    m_file_count = file_count;
+    m_hidden_file_count = hidden_file_count;
+    m_total_size = total_size;
     updateCountInfo();
 }
 
@@ -58,7 +58,7 @@ protected:
 protected Q_SLOTS:
     void onSingleFileChanged(const QString &oldUri, const QString &newUri);
     void countFilesAsync(const QStringList &uris);
-    void onFileCountOne(const QString &uri, quint64 size);
+    void onFileCountProgressed(quint64 file_count, quint64 hidden_file_count, quint64 total_size);
     void cancelCount();
 
     void updateInfo(const QString &uri);
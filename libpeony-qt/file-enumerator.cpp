@@ -23,6 +23,7 @@
 #include "file-enumerator.h"
 #include "file-info.h"
 #include "file-info-manager.h"
+#include "file-info-job.h"
 
 #include "mount-operation.h"
 
@@ -180,12 +181,45 @@ GFile *FileEnumerator::enumerateTargetFile()
     return target;
 }
 
+const char *FileEnumerator::enumerateAttributes()
+{
+    if (m_query_full_info)
+        return PEONY_FILE_INFO_QUERY_ATTRIBUTES;
+    return G_FILE_ATTRIBUTE_STANDARD_NAME;
+}
+
+void FileEnumerator::handleChildInfo(const QString &uri, GFileInfo *info, bool sync)
+{
+    if (!m_query_full_info)
+        return;
+
+    if (!g_file_info_has_attribute(info, G_FILE_ATTRIBUTE_STANDARD_DISPLAY_NAME)) {
+        //the info does not carry the contents, do not blank the shared info with it.
+        //an async enumeration leaves the info empty, its owner queries it and
+        //updates the view when the query finished.
+        auto fileInfo = FileInfo::fromUri(uri);
+        m_children_infos<<fileInfo;
+        if (sync) {
+            FileInfoJob job(fileInfo);
+            job.querySync();
+        }
+        return;
+    }
+
+    auto fileInfo = FileInfo::fromEnumeratedUri(uri, g_file_info_get_file_type(info));
+    //only the manager holds the info now, keep it until the items hold it.
+    m_children_infos<<fileInfo;
+    //the job only used for filling the info contents, no i/o here.
+    FileInfoJob job(fileInfo);
+    job.refreshInfoContents(info);
+}
+
 void FileEnumerator::enumerateSync()
 {
     GFile *target = enumerateTargetFile();
 
     GFileEnumerator *enumerator = g_file_enumerate_children(target,
-                                                            G_FILE_ATTRIBUTE_STANDARD_NAME,
+                                                            enumerateAttributes(),
                                                             G_FILE_QUERY_INFO_NONE,
                                                             m_cancellable,
                                                             nullptr);
@@ -282,7 +316,7 @@ void FileEnumerator::enumerateAsync()
     //auto uri = g_file_get_uri(m_root_file);
     //auto path = g_file_get_path(m_root_file);
     g_file_enumerate_children_async(m_root_file,
-                                    G_FILE_ATTRIBUTE_STANDARD_NAME,
+                                    enumerateAttributes(),
                                     G_FILE_QUERY_INFO_NONE,
                                     G_PRIORITY_DEFAULT,
                                     m_cancellable,
@@ -309,9 +343,11 @@ void FileEnumerator::enumerateChildren(GFileEnumerator *enumerator)
         if (path) {
             QString localUri = QString("file://%1").arg(path);
             *m_children_uris<<localUri;
+            handleChildInfo(localUri, info, true);
             g_free(path);
         } else {
            *m_children_uris<<uri;
+           handleChildInfo(uri, info, true);
         }
 
         g_free(uri);
@@ -465,10 +501,12 @@ GAsyncReadyCallback FileEnumerator::enumerator_next_files_async_ready_callback(G
             QString localUri = QString("file://%1").arg(path);
             uriList<<localUri;
             *(p_this->m_children_uris)<<localUri;
+            p_this->handleChildInfo(localUri, info);
             g_free(path);
         } else {
             uriList<<uri;
             *(p_this->m_children_uris)<<uri;
+            p_this->handleChildInfo(uri, info);
         }
 
         g_free(uri);
@@ -477,7 +515,16 @@ GAsyncReadyCallback FileEnumerator::enumerator_next_files_async_ready_callback(G
     }
     g_list_free_full(files, g_object_unref);
     Q_EMIT p_this->childrenUpdated(uriList);
-    if (files_count == PEONY_FIND_NEXT_FILES_BATCH_SIZE) {
+
+    //a search returns its results as soon as they are found, so a partial
+    //batch does not mean the end, only an empty batch does.
+    bool streaming = false;
+    char *root_uri = g_file_get_uri(p_this->m_root_file);
+    if (root_uri) {
+        streaming = g_str_has_prefix(root_uri, "search://");
+        g_free(root_uri);
+    }
+    if (files_count == PEONY_FIND_NEXT_FILES_BATCH_SIZE || streaming) {
         //have next files, countinue.
         g_file_enumerator_next_files_async(enumerator,
                                            PEONY_FIND_NEXT_FILES_BATCH_SIZE,
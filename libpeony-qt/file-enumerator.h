@@ -89,6 +89,23 @@ public:
 
     void setAutoDelete(bool autoDelete = true) {m_auto_delete = true;}
 
+    /*!
+     * \brief setQueryFullInfo
+     * \param full
+     * <br>
+     * By default, enumerator only query the children's name, and the holder
+     * have to start a FileInfoJob for every child later. That means there is
+     * one more query round trip for each child.
+     * If full is true, enumerator will query all the attributes FileInfoJob
+     * needs in the enumerating batches, and fill the children's FileInfo directly.
+     * The children's infos have been updated when childrenUpdated() or
+     * enumerateFinished() emitted.
+     * </br>
+     * \see PEONY_FILE_INFO_QUERY_ATTRIBUTES, FileInfoJob::refreshInfoContents().
+     */
+    void setQueryFullInfo(bool full = true) {m_query_full_info = full;}
+    bool isQueryFullInfo() {return m_query_full_info;}
+
 Q_SIGNALS:
     /*!
      * \brief prepared
@@ -162,6 +179,35 @@ protected:
      */
     GFile *enumerateTargetFile();
 
+    /*!
+     * \brief enumerateAttributes
+     * \return the attributes should be queried in enumerating.
+     * \see setQueryFullInfo().
+     */
+    const char *enumerateAttributes();
+
+    /*!
+     * \brief handleChildInfo
+     * \param uri
+     * \param info, the GFileInfo enumerated.
+     * \param sync, whether the info is queried synchronously when it has to be queried.
+     * <br>
+     * Fill the child's FileInfo with the enumerated GFileInfo,
+     * if enumerator is querying full info.
+     * </br>
+     * <br>
+     * Some enumerators do not return the queried attributes, such as the
+     * search vfs, which only returns the names. Their children are queried
+     * with a FileInfoJob in a sync enumeration, and are left empty in an async
+     * one, see FileInfo::isEmptyInfo().
+     * </br>
+     * <br>
+     * The filled infos are held by the enumerator until it is deleted, so that
+     * FileInfoManager won't evict them before the items take them.
+     * </br>
+     */
+    void handleChildInfo(const QString &uri, GFileInfo *info, bool sync = false);
+
     /*!
      * \brief mount_mountable_callback
      * \param file
@@ -215,8 +261,10 @@ private:
     GCancellable *m_cancellable = nullptr;
 
     QList<QString> *m_children_uris = nullptr;
+    QList<std::shared_ptr<FileInfo>> m_children_infos;
 
     bool m_auto_delete = false;
+    bool m_query_full_info = false;
 };
 
 }
@@ -30,7 +30,6 @@
 #include <gio/gdesktopappinfo.h>
 
 #include <QDebug>
-#include <QDateTime>
 #include <QIcon>
 #include <QUrl>
 
@@ -80,8 +79,10 @@ FileInfoJob::~FileInfoJob()
 void FileInfoJob::cancel()
 {
     //NOTE: do not use same cancellble for cancelling, otherwise all job might be cancelled.
-    g_cancellable_cancel(m_info->m_cancellable);
-    g_object_unref(m_info->m_cancellable);
+    if (m_info->m_cancellable) {
+        g_cancellable_cancel(m_info->m_cancellable);
+        g_object_unref(m_info->m_cancellable);
+    }
     m_info->m_cancellable = g_cancellable_new();
 }
 
@@ -98,7 +99,7 @@ bool FileInfoJob::querySync()
     GError *err = nullptr;
 
     auto _info = g_file_query_info(info->m_file,
-                                   "standard::*," "time::*," "access::*," "mountable::*," "metadata::*," G_FILE_ATTRIBUTE_ID_FILE,
+                                   PEONY_FILE_INFO_QUERY_ATTRIBUTES,
                                    G_FILE_QUERY_INFO_NONE,
                                    nullptr,
                                    &err);
@@ -154,7 +155,7 @@ void FileInfoJob::queryAsync()
         return;
     }
     g_file_query_info_async(info->m_file,
-                            "standard::*," "time::*," "access::*," "mountable::*," "metadata::*," G_FILE_ATTRIBUTE_ID_FILE,
+                            PEONY_FILE_INFO_QUERY_ATTRIBUTES,
                             G_FILE_QUERY_INFO_NONE,
                             G_PRIORITY_DEFAULT,
                             info->m_cancellable,
@@ -213,7 +214,7 @@ void FileInfoJob::refreshInfoContents(GFileInfo *new_info)
             while (*p) {
                 QIcon icon = QIcon::fromTheme(*p);
                 if (!icon.isNull()) {
-                    info->m_icon_name = QString (*p);
+                    info->m_icon_name = FileInfo::internString(QString (*p));
                     break;
                 } else {
                     p++;
@@ -228,35 +229,23 @@ void FileInfoJob::refreshInfoContents(GFileInfo *new_info)
     if (G_IS_ICON(g_symbolic_icon)) {
         const gchar* const* symbolic_icon_names = g_themed_icon_get_names(G_THEMED_ICON (g_symbolic_icon));
         if (symbolic_icon_names)
-            info->m_symbolic_icon_name = QString (*symbolic_icon_names);
+            info->m_symbolic_icon_name = FileInfo::internString(QString (*symbolic_icon_names));
         //g_object_unref(g_symbolic_icon);
     }
 
     info->m_file_id = g_file_info_get_attribute_string(new_info, G_FILE_ATTRIBUTE_ID_FILE);
 
-    info->m_content_type = g_file_info_get_content_type (new_info);
+    info->m_content_type = FileInfo::internString(g_file_info_get_content_type (new_info));
     info->m_size = g_file_info_get_attribute_uint64(new_info, G_FILE_ATTRIBUTE_STANDARD_SIZE);
     info->m_modified_time = g_file_info_get_attribute_uint64(new_info, G_FILE_ATTRIBUTE_TIME_MODIFIED);
     info->m_access_time = g_file_info_get_attribute_uint64(new_info, G_FILE_ATTRIBUTE_TIME_ACCESS);
 
-    const char *content_type_str = g_file_info_get_content_type (new_info);
-    info->m_mime_type_string = content_type_str;
-    if (content_type_str) {
-        char *content_type = g_content_type_get_description (content_type_str);
-        info->m_file_type = content_type;
-        g_free (content_type);
-        content_type = nullptr;
-    }
-
-    char *size_full = g_format_size_full(info->m_size, G_FORMAT_SIZE_DEFAULT);
-    info->m_file_size = size_full;
-    g_free(size_full);
+    info->m_file_type = FileInfo::typeDescription(info->m_content_type);
 
-    QDateTime date = QDateTime::fromMSecsSinceEpoch(info->m_modified_time*1000);
-    info->m_modified_date = date.toString(Qt::SystemLocaleShortDate);
-
-    date = QDateTime::fromMSecsSinceEpoch(info->m_access_time*1000);
-    info->m_access_date = date.toString(Qt::SystemLocaleShortDate);
+    //formatted strings will be created when they are used.
+    info->m_file_size = nullptr;
+    info->m_modified_date = nullptr;
+    info->m_access_date = nullptr;
 
     m_info->m_meta_info = FileMetaInfo::fromGFileInfo(m_info->uri(), new_info);
 
@@ -287,6 +276,7 @@ void FileInfoJob::refreshInfoContents(GFileInfo *new_info)
         g_object_unref(desktop_info);
     }
 
-    Q_EMIT info->updated();
+    //the slots might read the formatted strings, which take the lock.
     m_info->m_mutex.unlock();
+    Q_EMIT info->updated();
 }
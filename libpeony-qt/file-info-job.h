@@ -30,6 +30,14 @@
 #include <memory>
 #include <gio/gio.h>
 
+/*!
+ * \brief PEONY_FILE_INFO_QUERY_ATTRIBUTES
+ * The attributes FileInfoJob need for filling a FileInfo completely.
+ * FileEnumerator aslo use them when it is set to query full info.
+ * \see FileEnumerator::setQueryFullInfo().
+ */
+#define PEONY_FILE_INFO_QUERY_ATTRIBUTES "standard::*," "time::*," "access::*," "mountable::*," "metadata::*," G_FILE_ATTRIBUTE_ID_FILE
+
 namespace Peony {
 
 class FileInfo;
@@ -52,6 +60,7 @@ class FileInfo;
 class PEONYCORESHARED_EXPORT FileInfoJob : public QObject
 {
     friend class FileInfo;
+    friend class FileEnumerator;
 
     Q_OBJECT
 public:
@@ -22,76 +22,167 @@
 
 #include "file-info-manager.h"
 #include "thumbnail-manager.h"
+#include "global-settings.h"
 #include <QDebug>
 
 using namespace Peony;
 
-static FileInfoManager* global_file_info_manager = nullptr;
-static QHash<QString, std::shared_ptr<FileInfo>> *global_info_list = nullptr;
-
 FileInfoManager::FileInfoManager()
 {
-    global_info_list = new QHash<QString, std::shared_ptr<FileInfo>>();
+    auto settings = GlobalSettings::getInstance();
+    if (settings->isExist(FILE_INFO_CACHE_SIZE)) {
+        int size = settings->getValue(FILE_INFO_CACHE_SIZE).toInt();
+        if (size > 0)
+            m_cache_size = size;
+    }
 }
 
 FileInfoManager::~FileInfoManager()
 {
-    delete global_info_list;
+    clear();
 }
 
 FileInfoManager *FileInfoManager::getInstance()
 {
-    if (!global_file_info_manager)
-        global_file_info_manager = new FileInfoManager;
+    //the manager is aslo used in thumbnail and search threads,
+    //make sure it is only created once.
+    static FileInfoManager *global_file_info_manager = new FileInfoManager;
     return global_file_info_manager;
 }
 
+FileInfoManager::Shard &FileInfoManager::shardFor(const QString &uri)
+{
+    return m_shards[qHash(uri) % PEONY_FILE_INFO_MANAGER_SHARD_COUNT];
+}
+
 std::shared_ptr<FileInfo> FileInfoManager::findFileInfoByUri(QString uri)
 {
-    Q_ASSERT(global_info_list);
-    return global_info_list->value(uri);//.lock();
+    auto &shard = shardFor(uri);
+    QMutexLocker locker(&shard.mutex);
+    auto it = shard.hash.find(uri);
+    if (it == shard.hash.end())
+        return nullptr;
+
+    //move to the most recently used position.
+    shard.lru.splice(shard.lru.begin(), shard.lru, it->lru_pos);
+    return it->info;
 }
 
 std::shared_ptr<FileInfo> FileInfoManager::insertFileInfo(std::shared_ptr<FileInfo> info)
 {
-    Q_ASSERT(global_info_list);
+    QString uri = info->uri();
+    auto &shard = shardFor(uri);
+    QStringList evictedUris;
 
-    if (global_info_list->value(info->uri())) {
+    shard.mutex.lock();
+    auto it = shard.hash.find(uri);
+    if (it != shard.hash.end()) {
         //qDebug()<<"has info yet"<<info->uri();
-        info = global_info_list->value(info->uri());
+        shard.lru.splice(shard.lru.begin(), shard.lru, it->lru_pos);
+        info = it->info;
     } else {
-        global_info_list->insert(info->uri(), info);
+        shard.lru.push_front(uri);
+        CachedFileInfo cached;
+        cached.info = info;
+        cached.lru_pos = shard.lru.begin();
+        shard.hash.insert(uri, cached);
+        evictedUris = evictLocked(shard);
+    }
+    shard.mutex.unlock();
+
+    //do not hold the shard lock when calling other managers.
+    for (auto evictedUri : evictedUris) {
+        ThumbnailManager::getInstance()->releaseThumbnail(evictedUri);
     }
 
     return info;
 }
 
+QStringList FileInfoManager::evictLocked(Shard &shard)
+{
+    QStringList evictedUris;
+    int budget = qMax(1, m_cache_size.load()/PEONY_FILE_INFO_MANAGER_SHARD_COUNT);
+    //do not walk the whole list every time when most infos are in use.
+    int steps = PEONY_FILE_INFO_EVICT_STEPS;
+    while (shard.hash.count() > budget && steps > 0 && !shard.lru.empty()) {
+        steps--;
+        QString uri = shard.lru.back();
+        auto it = shard.hash.find(uri);
+        if (it == shard.hash.end()) {
+            shard.lru.pop_back();
+            continue;
+        }
+        if (it->info.use_count() > 1) {
+            //someone else still holds this info, treat it as recently used.
+            shard.lru.splice(shard.lru.begin(), shard.lru, it->lru_pos);
+            continue;
+        }
+        shard.lru.pop_back();
+        shard.hash.erase(it);
+        evictedUris<<uri;
+    }
+    return evictedUris;
+}
+
 void FileInfoManager::removeFileInfobyUri(QString uri)
 {
-    Q_ASSERT(global_info_list);
-    global_info_list->remove(uri);
+    auto &shard = shardFor(uri);
+    QMutexLocker locker(&shard.mutex);
+    auto it = shard.hash.find(uri);
+    if (it != shard.hash.end()) {
+        shard.lru.erase(it->lru_pos);
+        shard.hash.erase(it);
+    }
 }
 
 void FileInfoManager::clear()
 {
-    Q_ASSERT(global_info_list);
-    global_info_list->clear();
+    for (auto &shard : m_shards) {
+        QMutexLocker locker(&shard.mutex);
+        shard.hash.clear();
+        shard.lru.clear();
+    }
 }
 
 void FileInfoManager::remove(QString uri)
 {
     ThumbnailManager::getInstance()->releaseThumbnail(uri);
-    Q_ASSERT(global_info_list);
-    global_info_list->remove(uri);
+    removeFileInfobyUri(uri);
 }
 
 void FileInfoManager::remove(std::shared_ptr<FileInfo> info)
 {
-    Q_ASSERT(global_info_list);
     this->remove(info->uri());
 }
 
+void FileInfoManager::setCacheSize(int size)
+{
+    if (size <= 0)
+        size = PEONY_FILE_INFO_DEFAULT_CACHE_SIZE;
+    m_cache_size = size;
+    GlobalSettings::getInstance()->setValue(FILE_INFO_CACHE_SIZE, size);
+
+    QStringList evictedUris;
+    for (auto &shard : m_shards) {
+        QMutexLocker locker(&shard.mutex);
+        evictedUris<<evictLocked(shard);
+    }
+    for (auto evictedUri : evictedUris) {
+        ThumbnailManager::getInstance()->releaseThumbnail(evictedUri);
+    }
+}
+
+int FileInfoManager::count()
+{
+    int count = 0;
+    for (auto &shard : m_shards) {
+        QMutexLocker locker(&shard.mutex);
+        count += shard.hash.count();
+    }
+    return count;
+}
+
 void FileInfoManager::showState()
 {
-    qDebug()<<global_info_list->keys().count()<<global_info_list->values().count();
+    qDebug()<<count()<<m_cache_size.load();
 }
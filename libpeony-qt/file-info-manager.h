@@ -27,6 +27,21 @@
 
 #include <QHash>
 #include <QMutex>
+#include <QAtomicInt>
+
+#include <list>
+
+#ifndef PEONY_FILE_INFO_MANAGER_SHARD_COUNT
+#define PEONY_FILE_INFO_MANAGER_SHARD_COUNT 16
+#endif
+
+#ifndef PEONY_FILE_INFO_DEFAULT_CACHE_SIZE
+#define PEONY_FILE_INFO_DEFAULT_CACHE_SIZE 100000
+#endif
+
+#ifndef PEONY_FILE_INFO_EVICT_STEPS
+#define PEONY_FILE_INFO_EVICT_STEPS 64
+#endif
 
 namespace Peony {
 
@@ -40,13 +55,21 @@ namespace Peony {
  * use FileInfo::fromUri(), FileInfo::fromPath() or FileInfo::fromGFile()
  * for getting the corresponding shared data.
  * </br>
+ * <br>
+ * The cache is split into several shards by the hash of uri, every shard has
+ * its own lock, so the gui thread, thumbnail threads and search threads can
+ * access the manager concurrently and rarely wait each other.
+ * The cache has a size budget (count of infos, see setCacheSize()). When a shard
+ * is over its budget, the least recently used infos that nobody else holds will
+ * be evicted. The infos still referenced outside the manager are never evicted.
+ * </br>
  * \note The memory management is based on std smart pointer, but it is not regular.
  * Because hash table always hold a use count of shared data. If you want to use
  * shared data of this class instance, you should remenmber this point:
  * When releasing your info resources, you aslo need to add an additional judgment that whether
  * there is no other member but you and manager instance hold this shared data.
  * If true, you should aslo remove the element in manager's hash for really releasing resources.
- * Otherwise, it might cause an one-time memory leak.
+ * Otherwise, the info will be kept until it is evicted.
  * \see FileInfo, FileInfoJob, FileEnumerator; FileInfo::~FileInfo(), FileInfoJob::~FileInfoJob(),
  * FileEnumerator::~FileEnumerator().
  * \bug
@@ -63,8 +86,32 @@ public:
     void remove(QString uri);
     void remove(std::shared_ptr<FileInfo> info);
 
-    void lock() {m_mutex.tryLock();}
-    void unlock() {m_mutex.unlock();}
+    /*!
+     * \brief lock
+     * \deprecated
+     * The manager is thread safe itself, every shard is locked internally.
+     * This method does nothing now and is kept for compatibility.
+     */
+    void lock() {}
+    /*!
+     * \brief unlock
+     * \deprecated
+     * \see lock().
+     */
+    void unlock() {}
+
+    /*!
+     * \brief setCacheSize
+     * \param size, the max count of cached infos.
+     * <br>
+     * Set the budget of the cache. If size is not more than 0, the default size
+     * PEONY_FILE_INFO_DEFAULT_CACHE_SIZE will be used. The budget is aslo saved
+     * in global settings, see FILE_INFO_CACHE_SIZE.
+     * </br>
+     */
+    void setCacheSize(int size);
+    int cacheSize() {return m_cache_size.load();}
+    int count();
 
     void showState();
 
@@ -73,10 +120,35 @@ protected:
     void removeFileInfobyUri(QString uri); //{global_info_list->remove(uri);}
 
 private:
+    struct CachedFileInfo {
+        std::shared_ptr<FileInfo> info;
+        std::list<QString>::iterator lru_pos;
+    };
+
+    /*!
+     * \brief The Shard struct
+     * A part of the cache. The lru list keeps the uris from the most recently
+     * used to the least recently used one.
+     */
+    struct Shard {
+        QMutex mutex;
+        QHash<QString, CachedFileInfo> hash;
+        std::list<QString> lru;
+    };
+
     FileInfoManager();
     ~FileInfoManager();
 
-    QMutex m_mutex;
+    Shard &shardFor(const QString &uri);
+    /*!
+     * \brief evictLocked
+     * \param shard, must be locked.
+     * \return the uris evicted.
+     */
+    QStringList evictLocked(Shard &shard);
+
+    Shard m_shards[PEONY_FILE_INFO_MANAGER_SHARD_COUNT];
+    QAtomicInt m_cache_size = PEONY_FILE_INFO_DEFAULT_CACHE_SIZE;
 };
 
 }
@@ -29,19 +29,25 @@
 #include "thumbnail-manager.h"
 
 #include <QUrl>
+#include <QHash>
+#include <QMutex>
+#include <QDateTime>
 
 #include <QDebug>
 
 using namespace Peony;
 
+static QHash<QString, QString> *global_interned_strings = nullptr;
+static QHash<QString, QString> *global_type_descriptions = nullptr;
+static QMutex global_interned_strings_mutex;
+
 FileInfo::FileInfo(QObject *parent) : QObject (parent)
 {
-    m_cancellable = g_cancellable_new();
+
 }
 
 FileInfo::FileInfo(const QString &uri, QObject *parent) : QObject (parent)
 {
-    m_cancellable = g_cancellable_new();
     /*!
      * \note
      * In qt program we alwas handle file's uri format as unicode,
@@ -77,7 +83,8 @@ FileInfo::~FileInfo()
     //qDebug()<<"~FileInfo"<<m_uri;
     disconnect();
 
-    g_object_unref(m_cancellable);
+    if (m_cancellable)
+        g_object_unref(m_cancellable);
     g_object_unref(m_file);
 
     if (m_target_file)
@@ -89,6 +96,16 @@ FileInfo::~FileInfo()
 }
 
 std::shared_ptr<FileInfo> FileInfo::fromUri(QString uri, bool addToHash)
+{
+    return fromUriAndType(uri, G_FILE_TYPE_UNKNOWN, addToHash);
+}
+
+std::shared_ptr<FileInfo> FileInfo::fromEnumeratedUri(const QString &uri, GFileType type, bool addToHash)
+{
+    return fromUriAndType(uri, type, addToHash);
+}
+
+std::shared_ptr<FileInfo> FileInfo::fromUriAndType(const QString &uri, GFileType type, bool addToHash)
 {
     FileInfoManager *info_manager = FileInfoManager::getInstance();
     info_manager->lock();
@@ -96,34 +113,37 @@ std::shared_ptr<FileInfo> FileInfo::fromUri(QString uri, bool addToHash)
     if (info != nullptr) {
         info_manager->unlock();
         return info;
-    } else {
-        std::shared_ptr<FileInfo> newly_info = std::make_shared<FileInfo>();
-        QUrl url(uri);
-        newly_info->m_uri = url.toDisplayString();
-        newly_info->m_file = g_file_new_for_uri(newly_info->m_uri.toUtf8().constData());
-        newly_info->m_parent = g_file_get_parent(newly_info->m_file);
-        newly_info->m_is_remote = !g_file_is_native(newly_info->m_file);
-        GFileType type = g_file_query_file_type(newly_info->m_file,
-                                                G_FILE_QUERY_INFO_NONE,
-                                                nullptr);
-        switch (type) {
-        case G_FILE_TYPE_DIRECTORY:
-            //qDebug()<<"dir";
-            newly_info->m_is_dir = true;
-            break;
-        case G_FILE_TYPE_MOUNTABLE:
-            //qDebug()<<"mountable";
-            newly_info->m_is_volume = true;
-            break;
-        default:
-            break;
-        }
-        if (addToHash) {
-            newly_info = info_manager->insertFileInfo(newly_info);
-        }
-        info_manager->unlock();
-        return newly_info;
     }
+
+    std::shared_ptr<FileInfo> newly_info = std::make_shared<FileInfo>();
+    QUrl url(uri);
+    newly_info->m_uri = url.toDisplayString();
+    newly_info->m_file = g_file_new_for_uri(newly_info->m_uri.toUtf8().constData());
+    newly_info->m_parent = g_file_get_parent(newly_info->m_file);
+    newly_info->m_is_remote = !g_file_is_native(newly_info->m_file);
+    //an enumerated type is known already, do not query it again.
+    if (type == G_FILE_TYPE_UNKNOWN) {
+        type = g_file_query_file_type(newly_info->m_file,
+                                      G_FILE_QUERY_INFO_NONE,
+                                      nullptr);
+    }
+    switch (type) {
+    case G_FILE_TYPE_DIRECTORY:
+        //qDebug()<<"dir";
+        newly_info->m_is_dir = true;
+        break;
+    case G_FILE_TYPE_MOUNTABLE:
+        //qDebug()<<"mountable";
+        newly_info->m_is_volume = true;
+        break;
+    default:
+        break;
+    }
+    if (addToHash) {
+        newly_info = info_manager->insertFileInfo(newly_info);
+    }
+    info_manager->unlock();
+    return newly_info;
 }
 
 std::shared_ptr<FileInfo> FileInfo::fromPath(QString path, bool addToHash)
@@ -139,3 +159,76 @@ std::shared_ptr<FileInfo> FileInfo::fromGFile(GFile *file, bool addToHash)
     g_free(uri_str);
     return fromUri(uri, addToHash);
 }
+
+QString FileInfo::fileSize()
+{
+    //FileInfoJob might be refreshing the info in another thread.
+    QMutexLocker locker(&m_mutex);
+    if (m_file_size.isNull()) {
+        char *size_full = g_format_size_full(m_size, G_FORMAT_SIZE_DEFAULT);
+        m_file_size = size_full;
+        g_free(size_full);
+    }
+    return m_file_size;
+}
+
+QString FileInfo::modifiedDate()
+{
+    QMutexLocker locker(&m_mutex);
+    if (m_modified_date.isNull()) {
+        QDateTime date = QDateTime::fromMSecsSinceEpoch(m_modified_time*1000);
+        m_modified_date = date.toString(Qt::SystemLocaleShortDate);
+    }
+    return m_modified_date;
+}
+
+QString FileInfo::accessDate()
+{
+    QMutexLocker locker(&m_mutex);
+    if (m_access_date.isNull()) {
+        QDateTime date = QDateTime::fromMSecsSinceEpoch(m_access_time*1000);
+        m_access_date = date.toString(Qt::SystemLocaleShortDate);
+    }
+    return m_access_date;
+}
+
+QString FileInfo::internString(const QString &string)
+{
+    if (string.isEmpty())
+        return string;
+
+    QMutexLocker locker(&global_interned_strings_mutex);
+    if (!global_interned_strings)
+        global_interned_strings = new QHash<QString, QString>();
+
+    auto it = global_interned_strings->constFind(string);
+    if (it != global_interned_strings->constEnd())
+        return it.value();
+    global_interned_strings->insert(string, string);
+    return string;
+}
+
+QString FileInfo::typeDescription(const QString &contentType)
+{
+    if (contentType.isEmpty())
+        return nullptr;
+
+    global_interned_strings_mutex.lock();
+    if (!global_type_descriptions)
+        global_type_descriptions = new QHash<QString, QString>();
+    auto it = global_type_descriptions->constFind(contentType);
+    if (it != global_type_descriptions->constEnd()) {
+        QString description = it.value();
+        global_interned_strings_mutex.unlock();
+        return description;
+    }
+    global_interned_strings_mutex.unlock();
+
+    char *content_type = g_content_type_get_description(contentType.toUtf8().constData());
+    QString description = content_type;
+    g_free(content_type);
+
+    QMutexLocker locker(&global_interned_strings_mutex);
+    global_type_descriptions->insert(contentType, description);
+    return description;
+}
@@ -39,6 +39,7 @@ namespace Peony {
 
 class FileInfoJob;
 class FileMetaInfo;
+class FileEnumerator;
 
 /*!
  * \brief The FileInfo class
@@ -54,6 +55,7 @@ class PEONYCORESHARED_EXPORT FileInfo : public QObject
 {
     friend class FileInfoJob;
     friend class FileMetaInfo;
+    friend class FileEnumerator;
 
     Q_OBJECT
 public:
@@ -84,16 +86,23 @@ public:
     QString iconName() {return m_icon_name;}
     QString symbolicIconName() {return m_symbolic_icon_name;}
     QString fileID() {return m_file_id;}
-    QString mimeType() {return m_mime_type_string;}
+    QString mimeType() {return m_content_type;}
     QString fileType() {return m_file_type;}
 
-    QString fileSize() {return m_file_size;}
-    QString modifiedDate() {return m_modified_date;}
-    QString accessDate() {return m_access_date;}
+    /*!
+     * \brief fileSize
+     * \return the formatted size string.
+     * \note The formatted strings are created when they are first used,
+     * most infos in a large directory will never be displayed in these formats.
+     */
+    QString fileSize();
+    QString modifiedDate();
+    QString accessDate();
 
     QString type() {return m_content_type;}
     quint64 size() {return m_size;}
     quint64 modifiedTime() {return m_modified_time;}
+    std::shared_ptr<FileMetaInfo> metaInfo() {return m_meta_info;}
     quint64 accessTime() {return m_access_time;}
 
     bool canRead() {return m_can_read;}
@@ -145,7 +154,47 @@ public:
 Q_SIGNALS:
     void updated();
 
+protected:
+    /*!
+     * \brief fromEnumeratedUri
+     * \param uri
+     * \param type, the file type enumerator has known.
+     * \param addToHash
+     * <br>
+     * Similar to fromUri(), but it will not query the file type again,
+     * because FileEnumerator has got it in the enumerated GFileInfo.
+     * </br>
+     * \see FileEnumerator::setQueryFullInfo().
+     */
+    static std::shared_ptr<FileInfo> fromEnumeratedUri(const QString &uri, GFileType type, bool addToHash = true);
+
+    /*!
+     * \brief internString
+     * \param string
+     * \return the shared copy of string.
+     * <br>
+     * Content types, icon names and type descriptions are repeated by thousands
+     * of infos in a directory. Intern them so that all the infos share one copy.
+     * </br>
+     */
+    static QString internString(const QString &string);
+    /*!
+     * \brief typeDescription
+     * \param contentType
+     * \return the interned localized description of content type.
+     */
+    static QString typeDescription(const QString &contentType);
+
 private:
+    /*!
+     * \brief fromUriAndType
+     * \param uri
+     * \param type, the known file type, it will be queried if it is G_FILE_TYPE_UNKNOWN.
+     * \param addToHash
+     * \see fromUri(), fromEnumeratedUri().
+     */
+    static std::shared_ptr<FileInfo> fromUriAndType(const QString &uri, GFileType type, bool addToHash);
+
     QString m_uri = nullptr;
     bool m_is_valid = false;
     bool m_is_dir = false;
@@ -166,8 +215,8 @@ private:
     guint64 m_modified_time = 0;
     guint64 m_access_time = 0;
 
-    QString m_mime_type_string = nullptr;
     QString m_file_type = nullptr;
+    //lazily formatted, see fileSize(), modifiedDate() and accessDate().
     QString m_file_size = nullptr;
     QString m_modified_date = nullptr;
     QString m_access_date = nullptr;
@@ -193,6 +242,7 @@ private:
     /*!
      * \brief m_cancellable
      * This cancellable is used in async query file info in FileInfoJob instance.
+     * It is created when the first async job started.
      */
     GCancellable *m_cancellable = nullptr;
 
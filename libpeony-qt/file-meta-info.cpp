@@ -89,6 +89,9 @@ void FileMetaInfo::setMetaInfoVariant(const QString &key, const QVariant &value)
 
     m_meta_hash.remove(realKey);
     m_meta_hash.insert(realKey, value);
+    m_id_bits_mutex.lock();
+    m_id_bits_cache.remove(realKey);
+    m_id_bits_mutex.unlock();
     GFile *file = g_file_new_for_uri(m_uri.toUtf8().constData());
     GFileInfo *info = g_file_info_new();
     std::string tmp = realKey.toStdString();
@@ -137,6 +140,34 @@ const QStringList FileMetaInfo::getMetaInfoStringList(const QString &key)
     return getMetaInfoVariant(key).toString().split('\n');
 }
 
+const QBitArray FileMetaInfo::getMetaInfoIdBits(const QString &key)
+{
+    QString realKey = key;
+    if (!key.startsWith("metadata::"))
+        realKey = "metadata::" + key;
+
+    QMutexLocker locker(&m_id_bits_mutex);
+    auto it = m_id_bits_cache.constFind(realKey);
+    if (it != m_id_bits_cache.constEnd())
+        return it.value();
+
+    QBitArray bits;
+    auto var = getMetaInfoVariant(realKey);
+    if (!var.isNull()) {
+        for (auto string : var.toString().split('\n')) {
+            bool ok = false;
+            int id = string.toInt(&ok);
+            if (!ok || id < 0)
+                continue;
+            if (id >= bits.size())
+                bits.resize(id + 1);
+            bits.setBit(id);
+        }
+    }
+    m_id_bits_cache.insert(realKey, bits);
+    return bits;
+}
+
 int FileMetaInfo::getMetaInfoInt(const QString &key)
 {
     return getMetaInfoVariant(key).toString().toInt();
@@ -152,6 +183,9 @@ void FileMetaInfo::removeMetaInfo(const QString &key)
     if (!key.startsWith("metadata::"))
         realKey = "metadata::" + key;
     m_meta_hash.remove(realKey);
+    m_id_bits_mutex.lock();
+    m_id_bits_cache.remove(realKey);
+    m_id_bits_mutex.unlock();
     GFile *file = g_file_new_for_uri(m_uri.toUtf8().constData());
     g_file_set_attribute(file,
                          realKey.toUtf8().constData(),
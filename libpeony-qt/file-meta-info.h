@@ -28,6 +28,7 @@
 #include <QHash>
 #include <QVariant>
 #include <QMutex>
+#include <QBitArray>
 
 #include <memory>
 #include <gio/gio.h>
@@ -67,12 +68,27 @@ public:
     void setMetaInfoVariant(const QString &key, const QVariant &value);
     const QVariant getMetaInfoVariant(const QString &key);
 
+    /*!
+     * \brief getMetaInfoIdBits
+     * \param key, the key of a '\n' joined int list, such as label ids.
+     * \return the ints in list as a bitset.
+     * <br>
+     * The list is decoded once and cached until the value of key changed,
+     * so that it is cheap to check the ids many times, for example in
+     * filtering rows.
+     * </br>
+     */
+    const QBitArray getMetaInfoIdBits(const QString &key);
+
     void removeMetaInfo(const QString &key);
 
 private:
     QString m_uri;
     QHash<QString, QVariant> m_meta_hash;
     QMutex m_mutex;
+
+    QHash<QString, QBitArray> m_id_bits_cache;
+    QMutex m_id_bits_mutex;
 };
 
 }
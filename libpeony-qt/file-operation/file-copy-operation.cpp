@@ -24,17 +24,52 @@
 
 #include "file-node-reporter.h"
 #include "file-node.h"
-#include "file-enumerator.h"
+#include "file-tree-walker.h"
+#include "local-file-copier.h"
 #include "file-info.h"
 
 #include "file-utils.h"
 
 #include "file-operation-manager.h"
 
+#include <QThreadPool>
+#include <QThread>
+
 #include <QDebug>
 
 using namespace Peony;
 
+namespace Peony {
+
+/*!
+ * \brief The FileCopyWorker class
+ * A worker of parallel copying, it takes files from the operation's task queue
+ * one by one until the queue is closed and empty. Once the operation is cancelled,
+ * the remaining tasks are only released.
+ */
+class FileCopyWorker : public QRunnable
+{
+public:
+    explicit FileCopyWorker(FileCopyOperation *op) {
+        m_op = op;
+    }
+
+    void run() override {
+        FileCopyOperation::CopyTask task;
+        while (m_op->dequeueTask(task)) {
+            if (!m_op->isCancelled())
+                m_op->copyFile(task.node, task.dest_dir_uri);
+            if (!task.is_root)
+                delete task.node;
+        }
+    }
+
+private:
+    FileCopyOperation *m_op;
+};
+
+}
+
 static void handleDuplicate(FileNode *node) {
     QString name = node->destBaseName();
     QRegExp regExp("\\(\\d+\\)");
@@ -100,6 +135,7 @@ FileCopyOperation::FileCopyOperation(QStringList sourceUris, QString destDirUri,
     m_source_uris = sourceUris;
     m_dest_dir_uri = destDirUri;
     m_reporter = new FileNodeReporter;
+    m_reporter->setProgress(progress());
     connect(m_reporter, &FileNodeReporter::nodeFound, this, &FileOperation::operationPreparedOne);
 
     m_info = std::make_shared<FileOperationInfo>(sourceUris, destDirUri, FileOperationInfo::Copy);
@@ -122,268 +158,323 @@ FileOperation::ResponseType FileCopyOperation::prehandle(GError *err)
     return Other;
 }
 
+FileOperation::ResponseType FileCopyOperation::handleError(GError *err, const GErrorWrapperPtr &errPtr,
+                                                           const QString &srcUri, const QString &destUri)
+{
+    //errors of the parallel workers are handled one by one, so that the
+    //response of 'all' chosen for a file will be used by the waiting ones.
+    QMutexLocker locker(&m_error_mutex);
+    ResponseType handle_type = prehandle(err);
+    if (handle_type == Other) {
+        qDebug()<<"send error";
+        auto typeData = errored(srcUri, destUri, errPtr);
+        qDebug()<<"get return";
+        handle_type = typeData.value<ResponseType>();
+    }
+
+    switch (handle_type) {
+    case IgnoreAll: {
+        m_prehandle_hash.insert(err->code, IgnoreOne);
+        break;
+    }
+    case OverWriteAll: {
+        m_prehandle_hash.insert(err->code, OverWriteOne);
+        break;
+    }
+    case BackupAll: {
+        m_prehandle_hash.insert(err->code, BackupOne);
+        break;
+    }
+    default:
+        break;
+    }
+    return handle_type;
+}
+
 void FileCopyOperation::progress_callback(goffset current_num_bytes,
                                           goffset total_num_bytes,
-                                          FileCopyOperation *p_this)
+                                          CopyProgressData *data)
 {
-    auto currnet = p_this->m_current_offset + current_num_bytes;
-    auto total = p_this->m_total_szie;
-    qDebug()<<currnet*1.0/total;
-    Q_EMIT p_this->FileProgressCallback(p_this->m_current_src_uri,
-                                        p_this->m_current_dest_dir_uri,
-                                        currnet,
-                                        total);
+    Q_UNUSED(total_num_bytes)
+    //the progress is accumulated by all workers, only the increment is added.
+    auto bytes = current_num_bytes - data->notified_bytes;
+    data->notified_bytes = current_num_bytes;
+    data->op->notifyFileProgress(data->src_uri, data->dest_uri, bytes);
 }
 
-void FileCopyOperation::copyRecursively(FileNode *node)
+static QString normalizedUri(const QString &uri)
 {
-    if (isCancelled())
-        return;
+    GFile *file = g_file_new_for_uri(uri.toUtf8().constData());
+    char *tmp = g_file_get_uri(file);
+    g_object_unref(file);
+    QString normalized = tmp;
+    g_free(tmp);
+    return normalized;
+}
+
+FileNode *FileCopyOperation::copyTree(const QString &uri, bool parallel)
+{
+    FileNode *root = nullptr;
+    //the nodes of the folders being walked, their dest uris are used by children.
+    QList<FileNode*> folders;
+
+    FileTreeWalker walker(uri, getCancellable().get()->get());
+    while (walker.next()) {
+        if (isCancelled())
+            break;
+
+        if (walker.event() == FileTreeWalker::LeaveFolder) {
+            auto folder = folders.takeLast();
+            if (folder != root)
+                delete folder;
+            continue;
+        }
+
+        //the walker has queried the file, do not query it again.
+        FileNode *node = walker.info()? FileNode::fromInfo(walker.uri(), walker.info(), nullptr):
+                                        new FileNode(walker.uri(), nullptr, nullptr);
+        bool isRoot = !root;
+        if (isRoot)
+            root = node;
+        QString destDirUri = folders.isEmpty()? m_dest_dir_uri: folders.last()->destUri();
+
+        if (walker.event() == FileTreeWalker::EnterFolder) {
+            if (!isRoot && m_made_folder_uris.contains(normalizedUri(walker.uri()))) {
+                //the folder is a copy made by this operation, such as a/a
+                //when a is copied into itself, do not copy it again.
+                walker.skipChildren();
+                node->setState(FileNode::Handled);
+                folders<<node;
+                continue;
+            }
+            makeFolder(node, destDirUri);
+            if (!node->destUri().isEmpty())
+                m_made_folder_uris<<normalizedUri(node->destUri());
+            folders<<node;
+        } else if (parallel) {
+            CopyTask task;
+            task.node = node;
+            task.dest_dir_uri = destDirUri;
+            task.is_root = isRoot;
+            enqueueTask(task);
+        } else {
+            copyFile(node, destDirUri);
+            if (!isRoot)
+                delete node;
+        }
+    }
+
+    for (auto folder : folders) {
+        if (folder != root)
+            delete folder;
+    }
+    return root;
+}
+
+void FileCopyOperation::enqueueTask(const CopyTask &task)
+{
+    QMutexLocker locker(&m_task_queue_mutex);
+    while (m_task_queue.count() >= PEONY_COPY_QUEUE_SIZE) {
+        m_task_queue_not_full.wait(&m_task_queue_mutex);
+    }
+    m_task_queue.enqueue(task);
+    m_task_queue_not_empty.wakeOne();
+}
+
+bool FileCopyOperation::dequeueTask(CopyTask &task)
+{
+    QMutexLocker locker(&m_task_queue_mutex);
+    while (m_task_queue.isEmpty()) {
+        if (m_task_queue_closed)
+            return false;
+        m_task_queue_not_empty.wait(&m_task_queue_mutex);
+    }
+    task = m_task_queue.dequeue();
+    m_task_queue_not_full.wakeOne();
+    return true;
+}
+
+void FileCopyOperation::closeQueue()
+{
+    QMutexLocker locker(&m_task_queue_mutex);
+    m_task_queue_closed = true;
+    m_task_queue_not_empty.wakeAll();
+}
 
+void FileCopyOperation::makeFolder(FileNode *node, const QString &destDirUri)
+{
     node->setState(FileNode::Handling);
 
 fallback_retry:
-    QString destFileUri = node->resoveDestFileUri(m_dest_dir_uri);
+    QString destFileUri = node->resoveDestFileUri(destDirUri);
     node->setDestUri(destFileUri);
     qDebug()<<"dest file uri:"<<destFileUri;
 
     GFileWrapperPtr destFile = wrapGFile(g_file_new_for_uri(destFileUri.toUtf8().constData()));
 
-    m_current_src_uri = node->uri();
-    m_current_dest_dir_uri = destFileUri;
-
-    if (node->isFolder()) {
-        GError *err = nullptr;
+    GError *err = nullptr;
 
-        //NOTE: mkdir doesn't have a progress callback.
-        g_file_make_directory(destFile.get()->get(),
-                              getCancellable().get()->get(),
-                              &err);
-        if (err) {
-            if (err->code == G_IO_ERROR_CANCELLED) {
-                return;
-            }
-            auto errWrapperPtr = GErrorWrapper::wrapFrom(err);
-            ResponseType handle_type = prehandle(err);
-            if (handle_type == Other) {
-                qDebug()<<"send error";
-                auto typeData = errored(m_current_src_uri, m_current_dest_dir_uri, errWrapperPtr);
-                qDebug()<<"get return";
-                handle_type = typeData.value<ResponseType>();
-            }
-            //handle.
-            switch (handle_type) {
-            case IgnoreOne: {
-                node->setState(FileNode::Unhandled);
-                node->setErrorResponse(IgnoreOne);
-                break;
-            }
-            case IgnoreAll: {
-                node->setState(FileNode::Unhandled);
-                node->setErrorResponse(IgnoreOne);
-                m_prehandle_hash.insert(err->code, IgnoreOne);
-                break;
-            }
-            case OverWriteOne: {
-                node->setState(FileNode::Handled);
-                node->setErrorResponse(OverWriteOne);
-                //make dir has no overwrite
-                break;
-            }
-            case OverWriteAll: {
-                node->setState(FileNode::Handled);
-                node->setErrorResponse(OverWriteOne);
-                m_prehandle_hash.insert(err->code, OverWriteOne);
-                break;
-            }
-            case BackupOne: {
-                node->setState(FileNode::Handled);
-                node->setErrorResponse(BackupOne);
-                while (FileUtils::isFileExsit(node->resoveDestFileUri(m_dest_dir_uri))) {
-                    handleDuplicate(node);
-                }
-                goto fallback_retry;
-            }
-            case BackupAll: {
-                node->setState(FileNode::Handled);
-                node->setErrorResponse(BackupOne);
-                while (FileUtils::isFileExsit(node->resoveDestFileUri(m_dest_dir_uri))) {
-                    handleDuplicate(node);
-                }
-                //make dir has no backup
-                m_prehandle_hash.insert(err->code, BackupOne);
-                goto fallback_retry;
-            }
-            case Retry: {
-                goto fallback_retry;
-            }
-            case Cancel: {
-                node->setState(FileNode::Handled);
-                cancel();
-                break;
-            }
-            default:
-                break;
-            }
-        } else {
-            node->setState(FileNode::Handled);
+    //NOTE: mkdir doesn't have a progress callback.
+    g_file_make_directory(destFile.get()->get(),
+                          getCancellable().get()->get(),
+                          &err);
+    if (err) {
+        if (err->code == G_IO_ERROR_CANCELLED) {
+            g_error_free(err);
+            return;
         }
-        //assume that make dir finished anyway
-        m_current_offset += node->size();
-        Q_EMIT operationProgressedOne(node->uri(), node->destUri(), node->size());
-        for (auto child : *(node->children())) {
-            copyRecursively(child);
+        auto errWrapperPtr = GErrorWrapper::wrapFrom(err);
+        ResponseType handle_type = handleError(err, errWrapperPtr, node->uri(), destFileUri);
+        //handle.
+        switch (handle_type) {
+        case IgnoreOne:
+        case IgnoreAll: {
+            node->setState(FileNode::Unhandled);
+            node->setErrorResponse(IgnoreOne);
+            break;
         }
-    } else {
-        GError *err = nullptr;
-        GFileWrapperPtr sourceFile = wrapGFile(g_file_new_for_uri(node->uri().toUtf8().constData()));
-        g_file_copy(sourceFile.get()->get(),
-                    destFile.get()->get(),
-                    m_default_copy_flag,
-                    getCancellable().get()->get(),
-                    GFileProgressCallback(progress_callback),
-                    this,
-                    &err);
-
-        if (err) {
-            if (err->code == G_IO_ERROR_CANCELLED) {
-                return;
-            }
-            auto errWrapperPtr = GErrorWrapper::wrapFrom(err);
-            ResponseType handle_type = prehandle(err);
-            if (handle_type == Other) {
-                qDebug()<<"send error";
-                auto typeData = errored(m_current_src_uri, m_current_dest_dir_uri, errWrapperPtr);
-                qDebug()<<"get return";
-                handle_type = typeData.value<ResponseType>();
-            }
-            //handle.
-            switch (handle_type) {
-            case IgnoreOne: {
-                node->setState(FileNode::Unhandled);
-                node->setErrorResponse(IgnoreOne);
-                break;
-            }
-            case IgnoreAll: {
-                node->setState(FileNode::Unhandled);
-                node->setErrorResponse(IgnoreOne);
-                m_prehandle_hash.insert(err->code, IgnoreOne);
-                break;
-            }
-            case OverWriteOne: {
-                g_file_copy(sourceFile.get()->get(),
-                            destFile.get()->get(),
-                            GFileCopyFlags(m_default_copy_flag | G_FILE_COPY_OVERWRITE),
-                            getCancellable().get()->get(),
-                            GFileProgressCallback(progress_callback),
-                            this,
-                            nullptr);
-                node->setState(FileNode::Handled);
-                node->setErrorResponse(OverWriteOne);
-                break;
-            }
-            case OverWriteAll: {
-                g_file_copy(sourceFile.get()->get(),
-                            destFile.get()->get(),
-                            GFileCopyFlags(m_default_copy_flag | G_FILE_COPY_OVERWRITE),
-                            getCancellable().get()->get(),
-                            GFileProgressCallback(progress_callback),
-                            this,
-                            nullptr);
-                node->setState(FileNode::Handled);
-                node->setErrorResponse(OverWriteOne);
-                m_prehandle_hash.insert(err->code, OverWriteOne);
-                break;
-            }
-            case BackupOne: {
-                node->setState(FileNode::Handled);
-                node->setErrorResponse(BackupOne);
-                while (FileUtils::isFileExsit(node->resoveDestFileUri(m_dest_dir_uri))) {
-                    handleDuplicate(node);
-                }
-                goto fallback_retry;
-            }
-            case BackupAll: {
-                node->setState(FileNode::Handled);
-                node->setErrorResponse(BackupOne);
-                while (FileUtils::isFileExsit(node->resoveDestFileUri(m_dest_dir_uri))) {
-                    handleDuplicate(node);
-                }
-                m_prehandle_hash.insert(err->code, BackupOne);
-                goto fallback_retry;
-            }
-            case Retry: {
-                goto fallback_retry;
-            }
-            case Cancel: {
-                node->setState(FileNode::Handled);
-                cancel();
-                break;
-            }
-            default:
-                break;
+        case OverWriteOne:
+        case OverWriteAll: {
+            node->setState(FileNode::Handled);
+            node->setErrorResponse(OverWriteOne);
+            //make dir has no overwrite
+            break;
+        }
+        case BackupOne:
+        case BackupAll: {
+            node->setState(FileNode::Handled);
+            node->setErrorResponse(BackupOne);
+            while (FileUtils::isFileExsit(node->resoveDestFileUri(destDirUri))) {
+                handleDuplicate(node);
             }
-        } else {
+            goto fallback_retry;
+        }
+        case Retry: {
+            goto fallback_retry;
+        }
+        case Cancel: {
             node->setState(FileNode::Handled);
+            cancel();
+            break;
         }
-        m_current_offset += node->size();
-        Q_EMIT operationProgressedOne(node->uri(), node->destUri(), node->size());
+        default:
+            break;
+        }
+    } else {
+        node->setState(FileNode::Handled);
     }
-    destFile.reset();
+    //assume that make dir finished anyway
+    notifyProgressedOne(node->uri(), node->destUri(), node->size());
 }
 
-void FileCopyOperation::rollbackNodeRecursively(FileNode *node)
+void FileCopyOperation::copyFile(FileNode *node, const QString &destDirUri)
 {
-    switch (node->state()) {
-    case FileNode::Handling:
-    case FileNode::Handled: {
-        //do not clear the dest file if ignored or overwrite or backuped.
-        //FIXME: should i put it after recusion?
-        if (node->responseType() != Other)
-            break;
+    if (isCancelled())
+        return;
 
-        if (node->isFolder()) {
-            auto children = node->children();
-            for (auto child : *children) {
-                rollbackNodeRecursively(child);
-            }
-            GFile *dest_file = g_file_new_for_uri(node->destUri().toUtf8().constData());
-            //FIXME: there's a certain probability of failure to delete the folder without
-            //any problem happended. because somehow an empty file will created in the folder.
-            //i don't know why, but it is obvious that i have to delete them at first.
-            bool is_folder_deleted = g_file_delete(dest_file, nullptr, nullptr);
-            if (!is_folder_deleted) {
-                FileEnumerator e;
-                e.setEnumerateDirectory(node->destUri());
-                e.enumerateSync();
-                for (auto folder_child : *node->children()) {
-                    if (!folder_child->destUri().isEmpty()) {
-                        GFile *tmp_file = g_file_new_for_uri(folder_child->destUri().toUtf8().constData());
-                        g_file_delete(tmp_file, nullptr, nullptr);
-                        g_object_unref(tmp_file);
-                    }
-                    g_file_delete(dest_file, nullptr, nullptr);
-                }
-            }
-            g_object_unref(dest_file);
-        } else {
-            GFile *dest_file = g_file_new_for_uri(node->destUri().toUtf8().constData());
-            g_file_delete(dest_file, nullptr, nullptr);
-            g_object_unref(dest_file);
+    node->setState(FileNode::Handling);
+
+fallback_retry:
+    QString destFileUri = node->resoveDestFileUri(destDirUri);
+    node->setDestUri(destFileUri);
+    qDebug()<<"dest file uri:"<<destFileUri;
+
+    GFileWrapperPtr destFile = wrapGFile(g_file_new_for_uri(destFileUri.toUtf8().constData()));
+    GFileWrapperPtr sourceFile = wrapGFile(g_file_new_for_uri(node->uri().toUtf8().constData()));
+
+    //every worker has its own progress data.
+    CopyProgressData data;
+    data.op = this;
+    data.src_uri = node->uri();
+    data.dest_uri = destFileUri;
+    data.notified_bytes = 0;
+
+    GError *err = nullptr;
+    //local regular files are copied by the kernel, others fall back to g_file_copy().
+    LocalFileCopier::copy(sourceFile.get()->get(),
+                          destFile.get()->get(),
+                          m_default_copy_flag,
+                          getCancellable().get()->get(),
+                          GFileProgressCallback(progress_callback),
+                          &data,
+                          &err);
+
+    if (err) {
+        if (err->code == G_IO_ERROR_CANCELLED) {
+            g_error_free(err);
+            return;
         }
-        operationRollbackedOne(node->destUri(), node->uri());
-        break;
-    }
-    default: {
-        //make sure all nodes were rollbacked.
-        if (node->isFolder()) {
-            auto children = node->children();
-            for (auto child : *children) {
-                rollbackNodeRecursively(child);
+        auto errWrapperPtr = GErrorWrapper::wrapFrom(err);
+        ResponseType handle_type = handleError(err, errWrapperPtr, node->uri(), destFileUri);
+        //handle.
+        switch (handle_type) {
+        case IgnoreOne:
+        case IgnoreAll: {
+            node->setState(FileNode::Unhandled);
+            node->setErrorResponse(IgnoreOne);
+            break;
+        }
+        case OverWriteOne:
+        case OverWriteAll: {
+            LocalFileCopier::copy(sourceFile.get()->get(),
+                                  destFile.get()->get(),
+                                  GFileCopyFlags(m_default_copy_flag | G_FILE_COPY_OVERWRITE),
+                                  getCancellable().get()->get(),
+                                  GFileProgressCallback(progress_callback),
+                                  &data,
+                                  nullptr);
+            node->setState(FileNode::Handled);
+            node->setErrorResponse(OverWriteOne);
+            break;
+        }
+        case BackupOne:
+        case BackupAll: {
+            node->setState(FileNode::Handled);
+            node->setErrorResponse(BackupOne);
+            while (FileUtils::isFileExsit(node->resoveDestFileUri(destDirUri))) {
+                handleDuplicate(node);
             }
+            goto fallback_retry;
         }
-        break;
+        case Retry: {
+            goto fallback_retry;
+        }
+        case Cancel: {
+            node->setState(FileNode::Handled);
+            cancel();
+            break;
+        }
+        default:
+            break;
+        }
+    } else {
+        node->setState(FileNode::Handled);
     }
+    notifyProgressedOne(node->uri(), node->destUri(), node->size(), data.notified_bytes);
+}
+
+void FileCopyOperation::rollbackNode(FileNode *node)
+{
+    //do not clear the dest file if ignored or overwrite or backuped.
+    if (node->responseType() != Other)
+        return;
+    if (node->state() != FileNode::Handling && node->state() != FileNode::Handled)
+        return;
+    if (node->destUri().isEmpty())
+        return;
+
+    QString destRootUri = node->destUri();
+    FileTreeWalker walker(destRootUri);
+    while (walker.next()) {
+        if (walker.event() == FileTreeWalker::EnterFolder)
+            continue;
+
+        GFile *dest_file = g_file_new_for_uri(walker.uri().toUtf8().constData());
+        g_file_delete(dest_file, nullptr, nullptr);
+        g_object_unref(dest_file);
+
+        QString srcUri = node->uri() + walker.uri().mid(destRootUri.length());
+        operationRollbackedOne(walker.uri(), srcUri);
     }
 }
 
@@ -396,32 +487,51 @@ void FileCopyOperation::run()
 
     Q_EMIT operationRequestShowWizard();
 
-    goffset *total_size = new goffset(0);
+    //count the files in another thread, the copying starts at once
+    //and the total size of progress keeps growing until the scanning finished.
+    FileTreeScanner scanner(m_source_uris, m_reporter);
+    QThreadPool scannerPool;
+    scannerPool.setMaxThreadCount(1);
+    scannerPool.start(&scanner);
+
+    Q_EMIT operationPrepared();
+
+    int workerCount = 1;
+    if (m_parallel_copy)
+        workerCount = qBound(1, QThread::idealThreadCount(), PEONY_COPY_MAX_WORKER_COUNT);
+
+    //the folders are created by walker, files are copied by workers without
+    //waiting for the walking finished.
+    QThreadPool workerPool;
+    workerPool.setMaxThreadCount(workerCount);
+    m_task_queue_closed = false;
+    if (workerCount > 1) {
+        for (int i = 0; i < workerCount; i++) {
+            workerPool.start(new FileCopyWorker(this));
+        }
+    }
 
     QList<FileNode*> nodes;
     for (auto uri : m_source_uris) {
-        FileNode *node = new FileNode(uri, nullptr, m_reporter);
-        node->findChildrenRecursively();
-        node->computeTotalSize(total_size);
-        nodes<<node;
+        if (isCancelled())
+            break;
+        auto node = copyTree(uri, workerCount > 1);
+        if (node)
+            nodes<<node;
     }
-    Q_EMIT operationPrepared();
+    closeQueue();
+    workerPool.waitForDone();
 
-    m_total_szie = *total_size;
-    delete total_size;
+    scanner.stop();
+    scannerPool.waitForDone();
 
-    for (auto node : nodes) {
-        copyRecursively(node);
-    }
     Q_EMIT operationProgressed();
 
     if (isCancelled() && !hasError()) {
         Q_EMIT operationStartRollbacked();
-        for (auto file : nodes) {
-            qDebug()<<file->uri();
-            if (isCancelled()) {
-                rollbackNodeRecursively(file);
-            }
+        for (auto node : nodes) {
+            qDebug()<<node->uri();
+            rollbackNode(node);
         }
     }
 
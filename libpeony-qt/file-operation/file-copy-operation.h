@@ -27,10 +27,25 @@
 
 #include "file-operation.h"
 
+#include <QMutex>
+#include <QWaitCondition>
+#include <QQueue>
+#include <QSet>
+#include <QAtomicInteger>
+
+#ifndef PEONY_COPY_MAX_WORKER_COUNT
+#define PEONY_COPY_MAX_WORKER_COUNT 4
+#endif
+
+#ifndef PEONY_COPY_QUEUE_SIZE
+#define PEONY_COPY_QUEUE_SIZE 256
+#endif
+
 namespace Peony {
 
 class FileNodeReporter;
 class FileNode;
+class FileCopyWorker;
 
 /*!
  * \brief The FileCopyOperation class
@@ -39,11 +54,25 @@ class FileNode;
  */
 class PEONYCORESHARED_EXPORT FileCopyOperation : public FileOperation
 {
+    friend class FileCopyWorker;
     Q_OBJECT
 public:
     explicit FileCopyOperation(QStringList sourceUris, QString destDirUri, QObject *parent = nullptr);
     ~FileCopyOperation() override;
 
+    /*!
+     * \brief setParallelCopy
+     * \param parallel
+     * <br>
+     * If parallel copy is enabled (default), the operation creates the
+     * folders while walking the source trees, and the files are copied by
+     * at most PEONY_COPY_MAX_WORKER_COUNT workers concurrently. This is much
+     * faster for copying many small files. Otherwise the files are copied one
+     * by one in the order of the tree.
+     * </br>
+     */
+    void setParallelCopy(bool parallel = true) {m_parallel_copy = parallel;}
+
     void run() override;
     std::shared_ptr<FileOperationInfo> getOperationInfo() override {return m_info;}
 
@@ -52,24 +81,86 @@ public Q_SLOTS:
 
 protected:
     ResponseType prehandle(GError *err);
+    /*!
+     * \brief handleError
+     * \return the response type of the error.
+     * <br>
+     * Get the response from prehandle() or the error handler, the response of
+     * 'all' types will be remembered for the same kind of errors.
+     * It is thread safe, the errors from workers are handled one by one.
+     * </br>
+     */
+    ResponseType handleError(GError *err, const GErrorWrapperPtr &errPtr,
+                             const QString &srcUri, const QString &destUri);
+
+    struct CopyProgressData {
+        FileCopyOperation *op;
+        QString src_uri;
+        QString dest_uri;
+        //the bytes of current file which have been notified.
+        qint64 notified_bytes;
+    };
     static void progress_callback(goffset current_num_bytes,
                                   goffset total_num_bytes,
-                                  FileCopyOperation *p_this);
+                                  CopyProgressData *data);
+    /*!
+     * \brief copyTree
+     * \param uri, the source uri.
+     * \param parallel, hand the files to the copy workers or copy them in place.
+     * \return the root node of the source tree, it is kept for rolling back.
+     * <br>
+     * Walk the source tree and copy the files at once, without building the
+     * whole tree first. Only the node being handled is kept in memory, the
+     * other nodes are deleted as soon as they are handled.
+     * </br>
+     * <br>
+     * The folders made by this operation are not walked, otherwise copying
+     * a folder into itself or its subfolders would never end.
+     * </br>
+     */
+    FileNode *copyTree(const QString &uri, bool parallel);
+
     /*!
-     * \brief copyRecursively
+     * \brief makeFolder
      * \param node
-     * \see FileMoveOperation::copyRecursively()
+     * \param destDirUri, the dest uri of the parent folder.
      */
-    void copyRecursively(FileNode *node);
+    void makeFolder(FileNode *node, const QString &destDirUri);
     /*!
-     * \brief rollbackNodeRecursively
+     * \brief copyFile
      * \param node
+     * \param destDirUri, the dest uri of the parent folder.
+     * \note this method might be called in workers concurrently.
+     */
+    void copyFile(FileNode *node, const QString &destDirUri);
+
+    struct CopyTask {
+        FileNode *node;
+        QString dest_dir_uri;
+        bool is_root;
+    };
+    /*!
+     * \brief enqueueTask
+     * \param task
+     * <br>
+     * Hand a file to the copy workers, it blocks if there are already
+     * PEONY_COPY_QUEUE_SIZE files waiting, so that the walker does not
+     * run too far ahead of the workers.
+     * </br>
+     */
+    void enqueueTask(const CopyTask &task);
+    bool dequeueTask(CopyTask &task);
+    void closeQueue();
+
+    /*!
+     * \brief rollbackNode
+     * \param node, the root node of a source tree.
      * \details
-     * This function is similar to FileMoveOperation::rollbackNodeRecursively(),
-     * but it is more simple. The copy operation's rollbacking logic is easier to
-     * understand.
+     * A folder created by this operation only contains the files copied by
+     * this operation, so its dest tree is deleted as a whole. The folders and
+     * files which existed before (overwritten, ignored or backuped) are kept.
      */
-    void rollbackNodeRecursively(FileNode *node);
+    void rollbackNode(FileNode *node);
 
 private:
     /*!
@@ -89,13 +180,11 @@ private:
     QStringList m_source_uris;
     QString m_dest_dir_uri = nullptr;
 
+    //the normalized uris of the dest folders made by copyTree().
+    QSet<QString> m_made_folder_uris;
+
     int m_current_count = 0;
     int m_total_count = 0;
-    QString m_current_src_uri = nullptr;
-    QString m_current_dest_dir_uri = nullptr;
-
-    goffset m_current_offset = 0;
-    goffset m_total_szie = 0;
 
     GFileCopyFlags m_default_copy_flag = GFileCopyFlags(G_FILE_COPY_NOFOLLOW_SYMLINKS|
                                                         G_FILE_COPY_ALL_METADATA);
@@ -109,6 +198,15 @@ private:
      * for next prehandleing.
      */
     QHash<int, ResponseType> m_prehandle_hash;
+    QMutex m_error_mutex;
+
+    bool m_parallel_copy = true;
+
+    QQueue<CopyTask> m_task_queue;
+    bool m_task_queue_closed = false;
+    QMutex m_task_queue_mutex;
+    QWaitCondition m_task_queue_not_empty;
+    QWaitCondition m_task_queue_not_full;
 
     std::shared_ptr<FileOperationInfo> m_info = nullptr;
 };
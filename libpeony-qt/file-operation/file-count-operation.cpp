@@ -22,25 +22,156 @@
 
 #include "file-count-operation.h"
 
-#include "file-node-reporter.h"
-#include "file-node.h"
+#include <QThreadPool>
+#include <QThread>
+
+#include <QDebug>
+
+#include <gio/gio.h>
+
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <dirent.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <string.h>
+
+#define COUNT_QUERY_ATTRIBUTES G_FILE_ATTRIBUTE_STANDARD_NAME "," \
+    G_FILE_ATTRIBUTE_STANDARD_TYPE "," \
+    G_FILE_ATTRIBUTE_STANDARD_SIZE
 
 using namespace Peony;
 
+namespace Peony {
+
+/*!
+ * \brief The FileCountWorker class
+ * A worker of counting. It scans the folders in its own stack depth first,
+ * and shares the shallower half of the stack when other workers are idle.
+ */
+class FileCountWorker : public QRunnable
+{
+public:
+    explicit FileCountWorker(FileCountOperation *op) {
+        m_op = op;
+    }
+
+    void run() override {
+        FileCountOperation::CountTask task;
+        while (m_op->takeTask(task)) {
+            QList<FileCountOperation::CountTask> stack;
+            stack<<task;
+            while (!stack.isEmpty() && !m_op->isCancelled()) {
+                auto current = stack.takeLast();
+                if (current.path.isEmpty())
+                    scanRemoteFolder(current, stack);
+                else
+                    scanLocalFolder(current, stack);
+
+                m_op->addCount(m_file_count, m_hidden_file_count, m_total_size);
+                m_file_count = 0;
+                m_hidden_file_count = 0;
+                m_total_size = 0;
+
+                if (stack.count() > 1 && m_op->hasIdleWorker())
+                    m_op->shareTasks(stack);
+            }
+            m_op->finishTask();
+        }
+    }
+
+private:
+    void scanLocalFolder(const FileCountOperation::CountTask &task, QList<FileCountOperation::CountTask> &stack) {
+        int fd = open(task.path.constData(), O_RDONLY|O_DIRECTORY|O_NOFOLLOW|O_CLOEXEC);
+        if (fd < 0)
+            return;
+        DIR *dir = fdopendir(fd);
+        if (!dir) {
+            close(fd);
+            return;
+        }
+
+        struct dirent *entry;
+        while ((entry = readdir(dir))) {
+            const char *name = entry->d_name;
+            if (strcmp(name, ".") == 0 || strcmp(name, "..") == 0)
+                continue;
+
+            bool hidden = task.hidden || name[0] == '.';
+            m_file_count++;
+            if (hidden)
+                m_hidden_file_count++;
+
+            struct stat st;
+            if (fstatat(fd, name, &st, AT_SYMLINK_NOFOLLOW) != 0)
+                continue;
+            m_total_size += quint64(st.st_size);
+
+            if (S_ISDIR(st.st_mode)) {
+                FileCountOperation::CountTask child;
+                child.path = task.path + "/" + name;
+                child.hidden = hidden;
+                stack<<child;
+            }
+        }
+        //closes fd too.
+        closedir(dir);
+    }
+
+    void scanRemoteFolder(const FileCountOperation::CountTask &task, QList<FileCountOperation::CountTask> &stack) {
+        GFile *folder = g_file_new_for_uri(task.uri.toUtf8().constData());
+        GFileEnumerator *enumerator = g_file_enumerate_children(folder,
+                                                                COUNT_QUERY_ATTRIBUTES,
+                                                                G_FILE_QUERY_INFO_NOFOLLOW_SYMLINKS,
+                                                                nullptr,
+                                                                nullptr);
+        if (!enumerator) {
+            g_object_unref(folder);
+            return;
+        }
+
+        GFileInfo *info = nullptr;
+        while ((info = g_file_enumerator_next_file(enumerator, nullptr, nullptr))) {
+            const char *name = g_file_info_get_name(info);
+            bool hidden = task.hidden || name[0] == '.';
+            m_file_count++;
+            if (hidden)
+                m_hidden_file_count++;
+            m_total_size += quint64(g_file_info_get_size(info));
+
+            if (g_file_info_get_file_type(info) == G_FILE_TYPE_DIRECTORY) {
+                GFile *child = g_file_get_child(folder, name);
+                char *uri = g_file_get_uri(child);
+                FileCountOperation::CountTask childTask;
+                childTask.uri = uri;
+                childTask.hidden = hidden;
+                stack<<childTask;
+                g_free(uri);
+                g_object_unref(child);
+            }
+            g_object_unref(info);
+
+            if (m_op->isCancelled())
+                break;
+        }
+
+        g_file_enumerator_close(enumerator, nullptr, nullptr);
+        g_object_unref(enumerator);
+        g_object_unref(folder);
+    }
+
+    FileCountOperation *m_op;
+    quint64 m_file_count = 0;
+    quint64 m_hidden_file_count = 0;
+    quint64 m_total_size = 0;
+};
+
+}
+
 FileCountOperation::FileCountOperation(const QStringList &uris, bool countRoot, QObject *parent)
     : FileOperation (parent)
 {
     m_count_root = countRoot;
-    m_reporter = new FileNodeReporter(this);
-    //connect(m_reporter, &FileNodeReporter::nodeFound, this, &FileOperation::operationPreparedOne);
-    connect(m_reporter, &FileNodeReporter::nodeFound, [=](const QString &uri, quint64 size){
-        m_file_count++;
-        if (uri.contains("/.")) {
-            m_hidden_file_count++;
-        }
-        m_total_size += size;
-        Q_EMIT this->operationPreparedOne(uri, size);
-    });
     m_uris = uris;
 }
 
@@ -52,7 +183,55 @@ FileCountOperation::~FileCountOperation()
 void FileCountOperation::cancel()
 {
     FileOperation::cancel();
-    m_reporter->cancel();
+    //wake the idle workers, so that they can quit.
+    QMutexLocker locker(&m_task_mutex);
+    m_task_cond.wakeAll();
+}
+
+bool FileCountOperation::takeTask(CountTask &task)
+{
+    QMutexLocker locker(&m_task_mutex);
+    while (m_shared_tasks.isEmpty()) {
+        if (m_busy_worker_count == 0 || isCancelled()) {
+            m_task_cond.wakeAll();
+            return false;
+        }
+        m_idle_worker_count.ref();
+        m_task_cond.wait(&m_task_mutex);
+        m_idle_worker_count.deref();
+    }
+    if (isCancelled())
+        return false;
+    task = m_shared_tasks.takeLast();
+    m_busy_worker_count++;
+    return true;
+}
+
+void FileCountOperation::shareTasks(QList<CountTask> &tasks)
+{
+    //the first ones are the shallowest folders, they are likely
+    //to have larger subtrees.
+    int count = tasks.count()/2;
+    QMutexLocker locker(&m_task_mutex);
+    for (int i = 0; i < count; i++) {
+        m_shared_tasks.prepend(tasks.takeFirst());
+    }
+    m_task_cond.wakeAll();
+}
+
+void FileCountOperation::finishTask()
+{
+    QMutexLocker locker(&m_task_mutex);
+    m_busy_worker_count--;
+    if (m_busy_worker_count == 0 && m_shared_tasks.isEmpty())
+        m_task_cond.wakeAll();
+}
+
+void FileCountOperation::addCount(quint64 file_count, quint64 hidden_file_count, quint64 total_size)
+{
+    m_file_count.fetchAndAddRelaxed(file_count);
+    m_hidden_file_count.fetchAndAddRelaxed(hidden_file_count);
+    m_total_size.fetchAndAddRelaxed(total_size);
 }
 
 void FileCountOperation::run()
@@ -61,28 +240,54 @@ void FileCountOperation::run()
     if (m_uris.isEmpty())
         Q_EMIT operationFinished();
 
-    QList<FileNode *> nodes;
     for (auto uri : m_uris) {
-        auto node = new FileNode(uri, nullptr, m_reporter);
-        node->findChildrenRecursively();
-        nodes<<node;
-    }
-    if (!this->isCancelled()) {
-        if (!m_count_root) {
-            for (auto node : nodes) {
-                m_file_count--;
-                if (node->baseName().startsWith(".")) {
-                    m_hidden_file_count--;
-                }
-                //m_total_size -= node->size();
+        GFile *file = g_file_new_for_uri(uri.toUtf8().constData());
+        GFileInfo *info = g_file_query_info(file,
+                                            COUNT_QUERY_ATTRIBUTES,
+                                            G_FILE_QUERY_INFO_NOFOLLOW_SYMLINKS,
+                                            nullptr,
+                                            nullptr);
+        bool hidden = uri.contains("/.");
+        if (m_count_root) {
+            addCount(1, hidden? 1: 0, 0);
+        }
+        if (info) {
+            addCount(0, 0, quint64(g_file_info_get_size(info)));
+            if (g_file_info_get_file_type(info) == G_FILE_TYPE_DIRECTORY) {
+                CountTask task;
+                task.uri = uri;
+                task.hidden = hidden;
+                char *path = g_file_get_path(file);
+                if (path && g_file_is_native(file))
+                    task.path = path;
+                g_free(path);
+                m_shared_tasks<<task;
             }
+            g_object_unref(info);
         }
-        Q_EMIT countDone(m_file_count, m_hidden_file_count, m_total_size);
+        g_object_unref(file);
     }
-    qDebug()<<m_file_count<<m_hidden_file_count<<m_total_size;
+
+    int workerCount = 0;
+    if (!m_shared_tasks.isEmpty())
+        workerCount = qBound(1, QThread::idealThreadCount(), PEONY_COUNT_MAX_THREAD_COUNT);
+    QThreadPool pool;
+    pool.setMaxThreadCount(qMax(1, workerCount));
+    for (int i = 0; i < workerCount; i++) {
+        pool.start(new FileCountWorker(this));
+    }
+
+    //report the progress at a fixed rate until all workers finished.
+    while (!pool.waitForDone(PEONY_COUNT_PROGRESS_INTERVAL)) {
+        if (!isCancelled())
+            Q_EMIT countProgressed(m_file_count.load(), m_hidden_file_count.load(), m_total_size.load());
+    }
+
+    if (!this->isCancelled()) {
+        Q_EMIT countProgressed(m_file_count.load(), m_hidden_file_count.load(), m_total_size.load());
+        Q_EMIT countDone(m_file_count.load(), m_hidden_file_count.load(), m_total_size.load());
+    }
+    qDebug()<<m_file_count.load()<<m_hidden_file_count.load()<<m_total_size.load();
     Q_EMIT operationPrepared();
     Q_EMIT operationFinished();
-    for (auto node : nodes) {
-        delete node;
-    }
 }
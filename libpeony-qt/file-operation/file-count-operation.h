@@ -25,12 +25,41 @@
 
 #include "file-operation.h"
 
+#include <QMutex>
+#include <QWaitCondition>
+#include <QAtomicInteger>
+
+#ifndef PEONY_COUNT_MAX_THREAD_COUNT
+#define PEONY_COUNT_MAX_THREAD_COUNT 8
+#endif
+
+//in milliseconds.
+#ifndef PEONY_COUNT_PROGRESS_INTERVAL
+#define PEONY_COUNT_PROGRESS_INTERVAL 100
+#endif
+
 namespace Peony {
 
-class FileNodeReporter;
+class FileCountWorker;
 
+/*!
+ * \brief The FileCountOperation class
+ * <br>
+ * Count the files, hidden files and total size of the trees. The folders are
+ * scanned by several workers concurrently. Every worker walks a subtree by itself,
+ * and gives a part of its pending folders to the idle workers, so that all workers
+ * keep busy even if the tree is unbalanced. Local folders are read by openat() and
+ * fstatat() directly, other folders are enumerated by gio.
+ * </br>
+ * <br>
+ * The counts are accumulated in workers and reported by countProgressed() at most
+ * once per PEONY_COUNT_PROGRESS_INTERVAL milliseconds, instead of a signal for every
+ * file found.
+ * </br>
+ */
 class FileCountOperation : public FileOperation
 {
+    friend class FileCountWorker;
     Q_OBJECT
 public:
     explicit FileCountOperation(const QStringList &uris, bool countRoot = true, QObject *parent = nullptr);
@@ -38,26 +67,59 @@ public:
     void run() override;
     std::shared_ptr<FileOperationInfo> getOperationInfo() override {return nullptr;}
     void getInfo(quint64 &file_count, quint64 &hidden_file_count, quint64 &total_size) {
-        file_count = m_file_count;
-        hidden_file_count = m_hidden_file_count;
-        total_size = m_total_size;
+        file_count = m_file_count.load();
+        hidden_file_count = m_hidden_file_count.load();
+        total_size = m_total_size.load();
     }
 
 Q_SIGNALS:
+    void countProgressed(quint64 file_count, quint64 hidden_file_count, quint64 total_size);
     void countDone(quint64 file_count, quint64 hidden_file_count, quint64 total_size);
 
 public Q_SLOTS:
     void cancel() override;
 
+protected:
+    /*!
+     * \brief The CountTask struct
+     * A folder to be scanned. The path is set for local folders,
+     * otherwise the folder is enumerated with its uri.
+     */
+    struct CountTask {
+        QByteArray path;
+        QString uri;
+        bool hidden;
+    };
+
+    /*!
+     * \brief takeTask
+     * \param task
+     * \return false if all the folders are scanned or the operation is cancelled.
+     * <br>
+     * Wait until there is a shared task, or all the other workers are idle.
+     * </br>
+     */
+    bool takeTask(CountTask &task);
+    void shareTasks(QList<CountTask> &tasks);
+    void finishTask();
+    bool hasIdleWorker() {return m_idle_worker_count.load() > 0;}
+
+    void addCount(quint64 file_count, quint64 hidden_file_count, quint64 total_size);
+
 private:
-    FileNodeReporter *m_reporter = nullptr;
     QStringList m_uris;
 
-    quint64 m_file_count = 0;
-    quint64 m_hidden_file_count = 0;
-    quint64 m_total_size = 0;
+    QAtomicInteger<quint64> m_file_count = 0;
+    QAtomicInteger<quint64> m_hidden_file_count = 0;
+    QAtomicInteger<quint64> m_total_size = 0;
 
     bool m_count_root = true;
+
+    QList<CountTask> m_shared_tasks;
+    int m_busy_worker_count = 0;
+    QAtomicInt m_idle_worker_count = 0;
+    QMutex m_task_mutex;
+    QWaitCondition m_task_cond;
 };
 
 }
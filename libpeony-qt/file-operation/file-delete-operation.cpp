@@ -22,8 +22,10 @@
 
 #include "file-delete-operation.h"
 #include "file-operation-manager.h"
-#include "file-node.h"
 #include "file-node-reporter.h"
+#include "file-tree-walker.h"
+
+#include <QThreadPool>
 
 using namespace Peony;
 
@@ -32,6 +34,7 @@ FileDeleteOperation::FileDeleteOperation(QStringList sourceUris, QObject *parent
     m_source_uris = sourceUris;
     m_reporter = new FileNodeReporter;
     m_info = std::make_shared<FileOperationInfo>(sourceUris, nullptr, FileOperationInfo::Delete);
+    m_reporter->setProgress(progress());
     connect(m_reporter, &FileNodeReporter::nodeFound, this, &FileOperation::operationPreparedOne);
 }
 
@@ -45,47 +48,39 @@ std::shared_ptr<FileOperationInfo> FileDeleteOperation::getOperationInfo()
     return m_info;
 }
 
-void FileDeleteOperation::deleteRecursively(FileNode *node)
+void FileDeleteOperation::deleteRecursively(const QString &uri)
 {
-    if (isCancelled())
-        return;
+    FileTreeWalker walker(uri, getCancellable().get()->get());
+    while (walker.next()) {
+        if (isCancelled())
+            return;
 
-    GFile *file = g_file_new_for_uri(node->uri().toUtf8().constData());
-    if (node->isFolder()) {
-        for (auto child : *(node->children())) {
-            deleteRecursively(child);
-        }
-        GError *err = nullptr;
-        g_file_delete(file,
-                      getCancellable().get()->get(),
-                      &err);
-        if (err) {
-            //if delete a file get into error, it might be a critical error.
-            auto response = errored(node->uri(), nullptr, GErrorWrapper::wrapFrom(err), true);
-            qDebug()<<response;
-            auto responseType = response.value<ResponseType>();
-            if (responseType == Cancel) {
-                cancel();
-            }
-        }
-    } else {
-        GError *err = nullptr;
-        g_file_delete(file,
-                      getCancellable().get()->get(),
-                      &err);
-        if (err) {
-            //if delete a file get into error, it might be a critical error.
-            auto response = errored(node->uri(), nullptr, GErrorWrapper::wrapFrom(err), true);
-            qDebug()<<response;
-            auto responseType = response.value<ResponseType>();
-            if (responseType == Cancel) {
-                cancel();
-            }
+        //folders are deleted when leaving them.
+        if (walker.event() == FileTreeWalker::EnterFolder)
+            continue;
+
+        deleteFile(walker.uri());
+    }
+}
+
+void FileDeleteOperation::deleteFile(const QString &uri)
+{
+    GFile *file = g_file_new_for_uri(uri.toUtf8().constData());
+    GError *err = nullptr;
+    g_file_delete(file,
+                  getCancellable().get()->get(),
+                  &err);
+    if (err) {
+        //if delete a file get into error, it might be a critical error.
+        auto response = errored(uri, nullptr, GErrorWrapper::wrapFrom(err), true);
+        qDebug()<<response;
+        auto responseType = response.value<ResponseType>();
+        if (responseType == Cancel) {
+            cancel();
         }
     }
     g_object_unref(file);
-    qDebug()<<"deleted";
-    operationAfterProgressedOne(node->uri());
+    notifyAfterProgressedOne(uri);
 }
 
 void FileDeleteOperation::run()
@@ -97,27 +92,26 @@ void FileDeleteOperation::run()
 
     Q_EMIT operationRequestShowWizard();
 
-    goffset *total_size = new goffset(0);
+    //count the files in another thread, deleting does not wait for it.
+    FileTreeScanner scanner(m_source_uris, m_reporter);
+    QThreadPool scannerPool;
+    scannerPool.setMaxThreadCount(1);
+    scannerPool.start(&scanner);
 
-    QList<FileNode*> nodes;
-    for (auto uri : m_source_uris) {
-        FileNode *node = new FileNode(uri, nullptr, m_reporter);
-        node->findChildrenRecursively();
-        node->computeTotalSize(total_size);
-        nodes<<node;
-    }
     operationPrepared();
 
-    m_total_szie = *total_size;
-    delete total_size;
-
     //jump to the clearing stage.
     operationProgressed();
 
-    for (auto node : nodes) {
-        deleteRecursively(node);
+    for (auto uri : m_source_uris) {
+        if (isCancelled())
+            break;
+        deleteRecursively(uri);
     }
 
+    scanner.stop();
+    scannerPool.waitForDone();
+
     Q_EMIT operationFinished();
 }
 
@@ -29,7 +29,6 @@
 
 namespace Peony {
 
-class FileNode;
 class FileNodeReporter;
 
 class PEONYCORESHARED_EXPORT FileDeleteOperation : public FileOperation
@@ -41,7 +40,17 @@ public:
 
     std::shared_ptr<FileOperationInfo> getOperationInfo() override;
 
-    void deleteRecursively(FileNode *node);
+    /*!
+     * \brief deleteRecursively
+     * \param uri
+     * <br>
+     * Walk the tree and delete the files at once, the folders are deleted
+     * after their children. The tree is not built, so the memory used is
+     * proportional to the depth of the tree.
+     * </br>
+     */
+    void deleteRecursively(const QString &uri);
+    void deleteFile(const QString &uri);
     void run() override;
 
     void cancel() override;
@@ -54,7 +63,6 @@ private:
     QString m_current_src_uri = nullptr;
 
     goffset m_current_offset = 0;
-    goffset m_total_szie = 0;
 
     FileNodeReporter *m_reporter = nullptr;
 
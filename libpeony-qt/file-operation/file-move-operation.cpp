@@ -104,12 +104,12 @@ void FileMoveOperation::progress_callback(goffset current_num_bytes,
                                           goffset total_num_bytes,
                                           FileMoveOperation *p_this)
 {
-    auto currnet = p_this->m_current_offset + current_num_bytes;
-    auto total = p_this->m_total_szie;
-    Q_EMIT p_this->FileProgressCallback(p_this->m_current_src_uri,
-                                        p_this->m_current_dest_dir_uri,
-                                        currnet,
-                                        total);
+    Q_UNUSED(total_num_bytes)
+    auto bytes = current_num_bytes - p_this->m_notified_bytes;
+    p_this->m_notified_bytes = current_num_bytes;
+    p_this->notifyFileProgress(p_this->m_current_src_uri,
+                               p_this->m_current_dest_dir_uri,
+                               bytes);
     //format: move srcUri to destDirUri: curent_bytes(count) of total_bytes(count).
 }
 
@@ -130,7 +130,7 @@ void FileMoveOperation::move()
     QList<FileNode*> nodes;
     for (auto srcUri : m_source_uris) {
         //FIXME: ignore the total size when using native move.
-        operationPreparedOne(srcUri, 0);
+        notifyPreparedOne(srcUri, 0);
         auto node = new FileNode(srcUri, nullptr, nullptr);
         nodes<<node;
     }
@@ -146,6 +146,7 @@ void FileMoveOperation::move()
         m_current_count = nodes.indexOf(file) + 1;
         m_current_src_uri = srcUri;
         m_current_dest_dir_uri = m_dest_dir_uri;
+        m_notified_bytes = 0;
 
         auto srcFile = wrapGFile(g_file_new_for_uri(srcUri.toUtf8().constData()));
         char *base_name = g_file_get_basename(srcFile.get()->get());
@@ -289,7 +290,7 @@ retry:
             file->setState(FileNode::Handled);
         }
         //FIXME: ignore the total size when using native move.
-        operationProgressedOne(file->uri(), file->destUri(), 0);
+        notifyProgressedOne(file->uri(), file->destUri(), 0);
     }
     //native move has not clear operation.
     operationProgressed();
@@ -497,10 +498,6 @@ fallback_retry:
         GError *err = nullptr;
 
         //NOTE: mkdir doesn't have a progress callback.
-        Q_EMIT FileProgressCallback(m_current_src_uri,
-                                    m_current_dest_dir_uri,
-                                    node->size(),
-                                    node->size());
         g_file_make_directory(destFile.get()->get(),
                               getCancellable().get()->get(),
                               &err);
@@ -569,12 +566,7 @@ fallback_retry:
             node->setState(FileNode::Handled);
         }
         //assume that make dir finished anyway
-        m_current_offset += node->size();
-        Q_EMIT FileProgressCallback(m_current_src_uri,
-                                    m_current_dest_dir_uri,
-                                    m_current_offset,
-                                    m_total_szie);
-        Q_EMIT operationProgressedOne(node->uri(), node->destUri(), node->size());
+        notifyProgressedOne(node->uri(), node->destUri(), node->size());
         for (auto child : *(node->children())) {
             copyRecursively(child);
         }
@@ -684,9 +676,8 @@ fallback_retry:
         } else {
             node->setState(FileNode::Handled);
         }
-        m_current_offset += node->size();
-        Q_EMIT FileProgressCallback(node->uri(), node->destUri(), m_current_offset, m_total_szie);
-        Q_EMIT operationProgressedOne(node->uri(), node->destUri(), node->size());
+        notifyProgressedOne(node->uri(), node->destUri(), node->size(), m_notified_bytes);
+        m_notified_bytes = 0;
     }
     destFile.reset();
     destRoot.reset();
@@ -713,8 +704,7 @@ void FileMoveOperation::deleteRecursively(FileNode *node)
         node->setState(FileNode::Cleared);
     }
     g_object_unref(file);
-    qDebug()<<"deleted";
-    operationAfterProgressedOne(node->uri());
+    notifyAfterProgressedOne(node->uri());
 }
 
 void FileMoveOperation::moveForceUseFallback()
@@ -724,23 +714,18 @@ void FileMoveOperation::moveForceUseFallback()
 
     Q_EMIT operationRequestShowWizard();
     m_reporter = new FileNodeReporter;
+    //the total size is accumulated in progress by the reporter.
+    m_reporter->setProgress(progress());
     connect(m_reporter, &FileNodeReporter::nodeFound, this, &FileMoveOperation::operationPreparedOne);
 
-    //FIXME: total size should not compute twice. I should get it from ui-thread.
-    goffset *total_size = new goffset(0);
-
     QList<FileNode*> nodes;
     for (auto uri : m_source_uris) {
         FileNode *node = new FileNode(uri, nullptr, m_reporter);
         node->findChildrenRecursively();
-        node->computeTotalSize(total_size);
         nodes<<node;
     }
     operationPrepared();
 
-    m_total_szie = *total_size;
-    delete total_size;
-
     for (auto node : nodes) {
         copyRecursively(node);
     }
@@ -154,8 +154,10 @@ private:
      */
     QString m_current_dest_dir_uri = nullptr;
 
-    goffset m_current_offset = 0;
-    goffset m_total_szie = 0;
+    /*!
+     * \brief m_notified_bytes, the bytes of current file notified in progress_callback.
+     */
+    goffset m_notified_bytes = 0;
 
     /*!
      * \brief m_force_use_callback
@@ -22,6 +22,7 @@
 
 #include "file-node-reporter.h"
 #include "file-node.h"
+#include "file-operation-progress.h"
 
 using namespace Peony;
 
@@ -34,3 +35,13 @@ FileNodeReporter::~FileNodeReporter()
 {
 
 }
+
+void FileNodeReporter::sendNodeFound(const QString &uri, const qint64 &offset)
+{
+    if (m_progress) {
+        m_progress->addTotal(offset);
+        if (!m_progress->tryReport(FileOperationProgress::Prepared))
+            return;
+    }
+    Q_EMIT nodeFound(uri, offset);
+}
@@ -31,6 +31,7 @@
 namespace Peony {
 
 class FileNode;
+class FileOperationProgress;
 
 /*!
  * \brief The FileNodeReporter class
@@ -46,9 +47,16 @@ public:
     explicit FileNodeReporter(QObject *parent = nullptr);
     ~FileNodeReporter();
 
-    void sendNodeFound(const QString &uri, const qint64 &offset) {
-        Q_EMIT nodeFound(uri, offset);
-    }
+    /*!
+     * \brief setProgress
+     * \param progress
+     * <br>
+     * If the progress is set, the found nodes are added to the progress,
+     * and nodeFound() is throttled by FileOperationProgress::tryReport().
+     * </br>
+     */
+    void setProgress(const std::shared_ptr<FileOperationProgress> &progress) {m_progress = progress;}
+    void sendNodeFound(const QString &uri, const qint64 &offset);
 
     void cancel() {m_cancelled = true;}
     bool isOperationCancelled() {return m_cancelled;}
@@ -71,6 +79,7 @@ Q_SIGNALS:
 
 private:
     bool m_cancelled = false;
+    std::shared_ptr<FileOperationProgress> m_progress;
 };
 
 }
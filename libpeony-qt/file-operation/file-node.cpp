@@ -21,12 +21,16 @@
  */
 
 #include "file-node.h"
-#include "file-enumerator.h"
-#include "file-info.h"
 #include "file-node-reporter.h"
 
+#include <QDebug>
+
 using namespace Peony;
 
+#define FILE_NODE_QUERY_ATTRIBUTES G_FILE_ATTRIBUTE_STANDARD_NAME "," \
+    G_FILE_ATTRIBUTE_STANDARD_TYPE "," \
+    G_FILE_ATTRIBUTE_STANDARD_SIZE
+
 FileNode::FileNode(QString uri, FileNode *parent, FileNodeReporter *reporter)
 {
     m_uri = uri;
@@ -38,16 +42,19 @@ FileNode::FileNode(QString uri, FileNode *parent, FileNodeReporter *reporter)
     m_dest_basename = basename;
     g_free(basename);
 
+    //query type and size at once.
     //use G_FILE_QUERY_INFO_NOFOLLOW_SYMLINKS to avoid unnecessary recursion.
-    m_is_folder = g_file_query_file_type(file, G_FILE_QUERY_INFO_NOFOLLOW_SYMLINKS, nullptr) == G_FILE_TYPE_DIRECTORY;
     GFileInfo *info = g_file_query_info(file,
-                                        G_FILE_ATTRIBUTE_STANDARD_SIZE,
-                                        G_FILE_QUERY_INFO_NONE,
+                                        FILE_NODE_QUERY_ATTRIBUTES,
+                                        G_FILE_QUERY_INFO_NOFOLLOW_SYMLINKS,
                                         nullptr,
                                         nullptr);
     g_object_unref(file);
-    m_size = g_file_info_get_size(info);
-    g_object_unref(info);
+    if (info) {
+        m_is_folder = g_file_info_get_file_type(info) == G_FILE_TYPE_DIRECTORY;
+        m_size = g_file_info_get_size(info);
+        g_object_unref(info);
+    }
 
     if (m_reporter) {
         m_reporter->sendNodeFound(m_uri, m_size);
@@ -56,6 +63,25 @@ FileNode::FileNode(QString uri, FileNode *parent, FileNodeReporter *reporter)
     m_children = new QList<FileNode*>();
 }
 
+FileNode *FileNode::fromInfo(const QString &uri, GFileInfo *info, FileNode *parent, FileNodeReporter *reporter)
+{
+    auto node = new FileNode;
+    node->m_uri = uri;
+    node->m_parent = parent;
+    node->m_reporter = reporter;
+    node->m_basename = g_file_info_get_name(info);
+    node->m_dest_basename = node->m_basename;
+    node->m_is_folder = g_file_info_get_file_type(info) == G_FILE_TYPE_DIRECTORY;
+    node->m_size = g_file_info_get_size(info);
+
+    if (node->m_reporter) {
+        node->m_reporter->sendNodeFound(node->m_uri, node->m_size);
+    }
+
+    node->m_children = new QList<FileNode*>();
+    return node;
+}
+
 FileNode::~FileNode() {
     qDebug()<<"delete node:"<<m_uri;
     m_uri.clear();
@@ -78,17 +104,38 @@ void FileNode::findChildrenRecursively()
 
     if (!m_is_folder)
         return;
-    else {
-        FileEnumerator e;
-        e.setEnumerateDirectory(m_uri);
-        e.enumerateSync();
-        auto infos = e.getChildren();
-        for (auto info: infos) {
-            FileNode *node = new FileNode(info->uri(), this, m_reporter);
-            m_children->append(node);
-            node->findChildrenRecursively();
-        }
+
+    //the enumerator provides the type and size of children,
+    //so that they don't need to be queried again.
+    GFile *folder = g_file_new_for_uri(m_uri.toUtf8().constData());
+    GFileEnumerator *enumerator = g_file_enumerate_children(folder,
+                                                            FILE_NODE_QUERY_ATTRIBUTES,
+                                                            G_FILE_QUERY_INFO_NOFOLLOW_SYMLINKS,
+                                                            nullptr,
+                                                            nullptr);
+    if (!enumerator) {
+        g_object_unref(folder);
+        return;
     }
+
+    GFileInfo *info = nullptr;
+    while ((info = g_file_enumerator_next_file(enumerator, nullptr, nullptr))) {
+        GFile *child = g_file_get_child(folder, g_file_info_get_name(info));
+        char *uri = g_file_get_uri(child);
+        FileNode *node = FileNode::fromInfo(uri, info, this, m_reporter);
+        g_free(uri);
+        g_object_unref(child);
+        g_object_unref(info);
+
+        m_children->append(node);
+        node->findChildrenRecursively();
+        if (m_reporter && m_reporter->isOperationCancelled())
+            break;
+    }
+
+    g_file_enumerator_close(enumerator, nullptr, nullptr);
+    g_object_unref(enumerator);
+    g_object_unref(folder);
 }
 
 void FileNode::computeTotalSize(goffset *offset)
@@ -69,6 +69,19 @@ public:
     };
 
     FileNode(QString uri, FileNode* parent, FileNodeReporter *reporter = nullptr);
+    /*!
+     * \brief fromInfo
+     * \param uri
+     * \param info, the info from an enumerator, it should contain standard::name,
+     * standard::type and standard::size, queried without following symbolic links.
+     * \param parent
+     * \param reporter
+     * <br>
+     * Build the node without querying the file again, this is used when the
+     * parent folder is enumerated.
+     * </br>
+     */
+    static FileNode *fromInfo(const QString &uri, GFileInfo *info, FileNode* parent, FileNodeReporter *reporter = nullptr);
     ~FileNode();
 
     //FIXME: do i need add cancel function?
@@ -142,6 +155,8 @@ public:
     const QString resoveDestFileUri(const QString &destRootDir);
 
 private:
+    FileNode() {}
+
     QString m_uri = nullptr;
     QString m_basename = nullptr;
     QString m_dest_basename = nullptr;
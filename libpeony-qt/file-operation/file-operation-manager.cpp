@@ -28,7 +28,6 @@
 #include <QMessageBox>
 #include <QApplication>
 #include <QTimer>
-#include <QtConcurrent>
 
 #include "file-copy-operation.h"
 #include "file-delete-operation.h"
@@ -41,17 +40,98 @@
 #include "file-operation-error-dialog.h"
 #include "file-operation-progress-wizard.h"
 
+#include <sys/stat.h>
+
 using namespace Peony;
 
 static FileOperationManager *global_instance = nullptr;
 
+namespace Peony {
+
+class FileOperationRunner : public QRunnable
+{
+public:
+    explicit FileOperationRunner(FileOperationManager *manager, FileOperation *operation) {
+        m_manager = manager;
+        m_operation = operation;
+    }
+
+    void run() override {
+        m_operation->run();
+        //the operation is deleted by the manager in main thread, after
+        //the queued signals of the operation are handled.
+        QMetaObject::invokeMethod(m_manager, "onOperationDone", Qt::QueuedConnection,
+                                  Q_ARG(Peony::FileOperation*, m_operation));
+    }
+
+private:
+    FileOperationManager *m_manager;
+    FileOperation *m_operation;
+};
+
+}
+
+/*!
+ * \brief deviceKeyOf
+ * \return "dev:<st_dev>" for a local file, or the scheme and the host for a
+ * remote file, so that every server (and every mtp device) has its own queue.
+ * A local file which does not exist yet, such as a destination, uses the
+ * device of its nearest existing ancestor.
+ */
+static QString deviceKeyOf(const QString &uri)
+{
+    QString key;
+    GFile *file = g_file_new_for_uri(uri.toUtf8().constData());
+    if (g_file_is_native(file)) {
+        char *path = g_file_get_path(file);
+        QByteArray localPath = path;
+        g_free(path);
+        struct stat st;
+        while (!localPath.isEmpty()) {
+            if (stat(localPath.constData(), &st) == 0) {
+                key = QString("dev:%1").arg(quint64(st.st_dev));
+                break;
+            }
+            int index = localPath.lastIndexOf('/');
+            if (index > 0)
+                localPath = localPath.left(index);
+            else
+                localPath = localPath == "/"? QByteArray(): QByteArray("/");
+        }
+    }
+    g_object_unref(file);
+
+    if (key.isEmpty()) {
+        QUrl url(uri);
+        key = url.scheme() + "://" + url.authority();
+    }
+    return key;
+}
+
+static bool isSameOrAncestor(const QString &ancestor, const QString &uri)
+{
+    if (ancestor.isEmpty() || uri.isEmpty())
+        return false;
+    if (uri == ancestor)
+        return true;
+    if (ancestor.endsWith("/"))
+        return uri.startsWith(ancestor);
+    return uri.startsWith(ancestor + "/");
+}
+
+static bool isOverlapped(const QString &uri1, const QString &uri2)
+{
+    return isSameOrAncestor(uri1, uri2) || isSameOrAncestor(uri2, uri1);
+}
+
 FileOperationManager::FileOperationManager(QObject *parent) : QObject(parent)
 {
     qRegisterMetaType<Peony::GErrorWrapperPtr>("Peony::GErrorWrapperPtr");
     qRegisterMetaType<Peony::GErrorWrapperPtr>("Peony::GErrorWrapperPtr&");
+    qRegisterMetaType<Peony::FileOperation*>("Peony::FileOperation*");
     m_thread_pool = new QThreadPool(this);
-    //Imitating queue execution.
-    m_thread_pool->setMaxThreadCount(1);
+    //the operations contending for a device are queued by schedule().
+    m_thread_pool->setMaxThreadCount(PEONY_MAX_CONCURRENT_OPERATIONS);
 }
 
 FileOperationManager::~FileOperationManager()
@@ -77,6 +157,26 @@ void FileOperationManager::close()
 
 void FileOperationManager::startOperation(FileOperation *operation, bool addToHistory)
 {
+    auto scheduledOperation = scheduledOperationOf(operation);
+    if (isConflicted(scheduledOperation)) {
+        //do not allow operation.
+        auto info = operation->getOperationInfo();
+        if (info && (info->operationType() == FileOperationInfo::Trash || info->operationType() == FileOperationInfo::Delete)) {
+            QMessageBox::critical(nullptr,
+                                  tr("Can't delete."),
+                                  tr("You can't delete a file when "
+                                     "the file is doing another operation"));
+        } else {
+            QMessageBox::critical(nullptr,
+                                  tr("File Operation is Conflicted"),
+                                  tr("The files are being used by another "
+                                     "operation, please try again after "
+                                     "it is done."));
+        }
+        operation->deleteLater();
+        return;
+    }
+
     QApplication::setQuitOnLastWindowClosed(false);
 
     connect(operation, &FileOperation::operationFinished, this, [=](){
@@ -88,7 +188,7 @@ void FileOperationManager::startOperation(FileOperation *operation, bool addToHi
 #else
         QTimer::singleShot(1000, [=](){
 #endif
-            int last_op_count = m_thread_pool->children().count();
+            int last_op_count = m_operations.count();
             if (last_op_count == 0) {
                 if (qApp->allWidgets().isEmpty()) {
                     if (!runbackend) {
@@ -99,42 +199,9 @@ void FileOperationManager::startOperation(FileOperation *operation, bool addToHi
         });
     });
 
-    auto operationInfo = operation->getOperationInfo();
-
-    bool allowParallel = false;
-
-    auto opType = operationInfo->operationType();
-    switch (opType) {
-    case FileOperationInfo::Trash:
-    case FileOperationInfo::Delete: {
-        allowParallel = true;
-        auto operationSrcs = operationInfo->sources();
-        auto currentOps = m_thread_pool->children();
-        QList<FileOperation *> ops;
-        for (auto child : currentOps) {
-            auto op = qobject_cast<FileOperation *>(child);
-            auto opInfo = op->getOperationInfo();
-            {
-                for (auto src : operationSrcs) {
-                    if (opInfo->sources().contains(src)) {
-                        //do not allow operation.
-                        QMessageBox::critical(nullptr,
-                                              tr("Can't delete."),
-                                              tr("You can't delete a file when"
-                                                 "the file is doing another operation"));
-                        return;
-                    }
-                }
-            }
-        }
-        break;
-    }
-    default:
-        break;
-    }
-
     FileOperationProgressWizard *wizard = new FileOperationProgressWizard;
     wizard->setAttribute(Qt::WA_DeleteOnClose);
+    wizard->setProgress(operation->progress());
     wizard->connect(operation, &FileOperation::operationRequestShowWizard, wizard, &FileOperationProgressWizard::delayShow);
     wizard->connect(operation, &FileOperation::operationRequestShowWizard, wizard, &FileOperationProgressWizard::switchToPreparedPage);
     wizard->connect(operation, &FileOperation::operationPreparedOne, wizard, &FileOperationProgressWizard::onElementFoundOne);
@@ -159,7 +226,9 @@ void FileOperationManager::startOperation(FileOperation *operation, bool addToHi
                        this, &FileOperationManager::handleError,
                        Qt::BlockingQueuedConnection);
 
-    operation->connect(operation, &FileOperation::operationFinished, [=](){
+    //the history is only touched in main thread, the operations finish in
+    //the worker threads concurrently. this is queued before onOperationDone().
+    connect(operation, &FileOperation::operationFinished, this, [=](){
         if (operation->hasError()) {
             this->clearHistory();
             return ;
@@ -178,26 +247,139 @@ void FileOperationManager::startOperation(FileOperation *operation, bool addToHi
         }
     });
 
-    if (!allowParallel) {
-        if (m_thread_pool->activeThreadCount() > 0) {
-            QMessageBox::warning(nullptr,
-                                 tr("File Operation is Busy"),
-                                 tr("There have been one or more file"
-                                    "operation(s) executing before. Your"
-                                    "operation will wait for executing"
-                                    "until it/them done."));
+    m_operations<<scheduledOperation;
+    if (!schedule(operation)) {
+        QMessageBox::warning(nullptr,
+                             tr("File Operation is Busy"),
+                             tr("There have been one or more file "
+                                "operation(s) executing before. Your "
+                                "operation will wait for executing "
+                                "until it/them done."));
+    }
+}
+
+FileOperationManager::ScheduledOperation FileOperationManager::scheduledOperationOf(FileOperation *operation)
+{
+    ScheduledOperation scheduledOperation;
+    scheduledOperation.operation = operation;
+    scheduledOperation.modifySources = false;
+    scheduledOperation.parallel = false;
+    scheduledOperation.running = false;
+
+    auto info = operation->getOperationInfo();
+    if (!info)
+        return scheduledOperation;
+
+    switch (info->operationType()) {
+    case FileOperationInfo::Trash:
+    case FileOperationInfo::Delete:
+        scheduledOperation.parallel = true;
+        scheduledOperation.modifySources = true;
+        break;
+    case FileOperationInfo::Move:
+    case FileOperationInfo::Rename:
+    case FileOperationInfo::Untrash:
+        scheduledOperation.modifySources = true;
+        break;
+    default:
+        break;
+    }
+
+    scheduledOperation.sources = info->sources();
+    //the target of trash is not a real location.
+    if (info->operationType() != FileOperationInfo::Trash)
+        scheduledOperation.target = info->target();
+
+    for (auto uri : scheduledOperation.sources) {
+        scheduledOperation.devices<<deviceKeyOf(uri);
+    }
+    if (!scheduledOperation.target.isEmpty())
+        scheduledOperation.devices<<deviceKeyOf(scheduledOperation.target);
+
+    return scheduledOperation;
+}
+
+bool FileOperationManager::isConflicted(const ScheduledOperation &operation)
+{
+    for (auto current : m_operations) {
+        if (!operation.modifySources && !current.modifySources)
+            continue;
+
+        for (auto src : operation.sources) {
+            for (auto currentSrc : current.sources) {
+                if (isOverlapped(src, currentSrc))
+                    return true;
+            }
+        }
+
+        //moving or deleting the folder which another operation is writing into,
+        //or writing into the folder which another operation is moving or deleting.
+        if (operation.modifySources) {
+            for (auto src : operation.sources) {
+                if (isSameOrAncestor(src, current.target))
+                    return true;
+            }
+        }
+        if (current.modifySources) {
+            for (auto currentSrc : current.sources) {
+                if (isSameOrAncestor(currentSrc, operation.target))
+                    return true;
+            }
+        }
+    }
+    return false;
+}
+
+bool FileOperationManager::schedule(FileOperation *operation)
+{
+    int runningCount = 0;
+    QSet<QString> busyDevices;
+    for (auto scheduledOperation : m_operations) {
+        if (scheduledOperation.running && !scheduledOperation.parallel) {
+            runningCount++;
+            busyDevices.unite(scheduledOperation.devices);
+        }
+    }
+
+    bool operationRunning = true;
+    for (auto &scheduledOperation : m_operations) {
+        if (scheduledOperation.running)
+            continue;
+
+        if (scheduledOperation.parallel) {
+            scheduledOperation.running = true;
+            QThreadPool::globalInstance()->start(new FileOperationRunner(this, scheduledOperation.operation));
+            continue;
+        }
+
+        bool canStart = runningCount < PEONY_MAX_CONCURRENT_OPERATIONS
+                && !busyDevices.intersects(scheduledOperation.devices);
+        //the devices of a waiting operation are reserved, so that the later
+        //operations on the same devices do not overtake it.
+        busyDevices.unite(scheduledOperation.devices);
+        if (!canStart) {
+            if (scheduledOperation.operation == operation)
+                operationRunning = false;
+            continue;
+        }
+
+        scheduledOperation.running = true;
+        runningCount++;
+        m_thread_pool->start(new FileOperationRunner(this, scheduledOperation.operation));
+    }
+    return operationRunning;
+}
+
+void FileOperationManager::onOperationDone(FileOperation *operation)
+{
+    for (int i = 0; i < m_operations.count(); i++) {
+        if (m_operations.at(i).operation == operation) {
+            m_operations.removeAt(i);
+            break;
         }
-        operation->setParent(m_thread_pool);
-        m_thread_pool->start(operation);
-    } else {
-        QtConcurrent::run([=]{
-            operation->setParent(m_thread_pool);
-            operation->setAutoDelete(false);
-            operation->run();
-            operation->setParent(nullptr);
-            operation->deleteLater();
-        });
     }
+    operation->deleteLater();
+    schedule();
 }
 
 void FileOperationManager::startUndoOrRedo(std::shared_ptr<FileOperationInfo> info)
@@ -33,9 +33,14 @@
 #include <QMutex>
 #include <QStack>
 #include <QThreadPool>
+#include <QSet>
 
 #include <QUrl>
 
+#ifndef PEONY_MAX_CONCURRENT_OPERATIONS
+#define PEONY_MAX_CONCURRENT_OPERATIONS 4
+#endif
+
 namespace Peony {
 
 class FileOperationInfo;
@@ -47,8 +52,13 @@ class FileOperationInfo;
  * And in peony-qt, it is similar to peony. But there are higher level
  * api to manage these 'managers' in peony-qt.
  * Not only the undo/redo stacks' management. FileOperationManager
- * only allows up to one file operation instace to run at same times,
- * this means the operations will be queue executed.
+ * schedules the operations by the devices of their sources and destination.
+ * The operations on independent devices run at the same time (up to
+ * PEONY_MAX_CONCURRENT_OPERATIONS), and the operations contending for the
+ * same device are queue executed, in the order they were started.
+ * An operation whose files overlap with the files of another operation,
+ * which is running or waiting, is refused if one of them modifies its
+ * sources (such as move, trash and delete).
  * FileOperationManager will provide the operation-ui and error-handler-ui
  * which are implement as defaut in peony-qt's operation frameworks.
  * \note
@@ -85,13 +95,41 @@ public Q_SLOTS:
 
     QVariant handleError(const QString &srcUri, const QString &destUri, const GErrorWrapperPtr &err, bool critical);
 
+private Q_SLOTS:
+    void onOperationDone(Peony::FileOperation *operation);
+
 private:
     explicit FileOperationManager(QObject *parent = nullptr);
     ~FileOperationManager();
 
+    struct ScheduledOperation {
+        FileOperation *operation;
+        QStringList sources;
+        QString target;
+        QSet<QString> devices;
+        bool modifySources;
+        //trash and delete do not wait for other operations.
+        bool parallel;
+        bool running;
+    };
+
+    ScheduledOperation scheduledOperationOf(FileOperation *operation);
+    bool isConflicted(const ScheduledOperation &operation);
+    /*!
+     * \brief schedule
+     * <br>
+     * Start the waiting operations whose devices are not used by the running
+     * operations or by the operations waiting before them.
+     * </br>
+     * \param operation, the operation interested in, such as the one just started.
+     * \return true if operation is running, or true if operation is nullptr.
+     */
+    bool schedule(FileOperation *operation = nullptr);
+
     QStack<std::shared_ptr<FileOperationInfo>> m_undo_stack;
     QStack<std::shared_ptr<FileOperationInfo>> m_redo_stack;
 
+    QList<ScheduledOperation> m_operations;
     QThreadPool *m_thread_pool;
     bool m_is_current_operation_errored = false;
 };
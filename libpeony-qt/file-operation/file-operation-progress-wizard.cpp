@@ -21,6 +21,7 @@
  */
 
 #include "file-operation-progress-wizard.h"
+#include "file-operation-progress.h"
 
 #include <QFormLayout>
 #include <QGridLayout>
@@ -36,6 +37,7 @@
 #include <QSystemTrayIcon>
 
 #include <QTimer>
+#include <QTime>
 
 #include <gio/gio.h>
 
@@ -85,9 +87,9 @@ FileOperationProgressWizard::FileOperationProgressWizard(QWidget *parent) : QWiz
         m_tray_icon->hide();
     });
 
-    m_delayer = new QTimer(this);
-    m_delayer->setSingleShot(true);
-    m_delayer->setInterval(100);
+    m_sampler = new QTimer(this);
+    m_sampler->setInterval(PEONY_PROGRESS_SAMPLE_INTERVAL);
+    connect(m_sampler, &QTimer::timeout, this, &FileOperationProgressWizard::sampleProgress);
 }
 
 FileOperationProgressWizard::~FileOperationProgressWizard()
@@ -130,18 +132,18 @@ void FileOperationProgressWizard::switchToPreparedPage()
     cancelButton->setEnabled(true);
 }
 
-void FileOperationProgressWizard::onElementFoundOne(const QString &uri, const qint64 &size)
+void FileOperationProgressWizard::setProgress(const std::shared_ptr<FileOperationProgress> &progress)
 {
-    qDebug()<<"onElementFound"<<uri<<size;
-    m_total_count++;
-    m_total_size += size;
-
-    char *format_size = g_format_size (quint64(m_total_size));
+    m_progress = progress;
+    m_last_sample_time = -1;
+    m_sampler->start();
+}
 
+void FileOperationProgressWizard::onElementFoundOne(const QString &uri, const qint64 &size)
+{
+    Q_UNUSED(size)
+    //the signal is throttled, the counts are sampled from progress.
     m_first_page->m_src_line->setText(uri);
-    m_first_page->m_state_line->setText(tr("%1 files, %2").arg(m_total_count).arg(format_size));
-
-    g_free(format_size);
 }
 
 void FileOperationProgressWizard::onElementFoundAll()
@@ -160,22 +162,9 @@ void FileOperationProgressWizard::switchToProgressPage()
 
 void FileOperationProgressWizard::onFileOperationProgressedOne(const QString &uri, const QString &destUri, const qint64 &size)
 {
-    qDebug()<<"onFileOperationFinishedOne"<<uri<<size;
-    m_current_count++;
-    m_current_size += size;
-
-    char *current_format_size = g_format_size (quint64(m_current_size));
-    char *total_format_size = g_format_size(quint64(m_total_size));
-    m_second_page->m_state_line->setText(tr("%1 done, %2 total, %3 of %4.").
-                                         arg(current_format_size).arg(total_format_size)
-                                         .arg(m_current_count).arg(m_total_count));
-
-    g_free(current_format_size);
-    g_free(total_format_size);
+    Q_UNUSED(size)
     m_second_page->m_src_line->setText(uri);
     m_second_page->m_dest_line->setText(destUri);
-    double test = (m_current_size*1.0/m_total_size)*100;
-    m_second_page->m_progress_bar->setValue(int(test));
 }
 
 void FileOperationProgressWizard::onFileOperationProgressedAll()
@@ -195,14 +184,7 @@ void FileOperationProgressWizard::switchToAfterProgressPage()
 
 void FileOperationProgressWizard::onElementClearOne(const QString &uri)
 {
-    m_third_page->m_file_deleted_count++;
-    m_third_page->m_src_line->setText(tr("clearing: %1, %2 of %3").arg(uri).
-                                      arg(m_third_page->m_file_deleted_count).
-                                      arg(m_total_count));
-
-    if (m_total_count > 0)
-        m_third_page->m_progress_bar->setValue(int(m_third_page->m_file_deleted_count*100.0)/m_total_count);
-
+    m_third_page->m_src_line->setText(tr("clearing: %1").arg(uri));
 }
 
 void FileOperationProgressWizard::switchToRollbackPage()
@@ -223,7 +205,7 @@ void FileOperationProgressWizard::onFileRollbacked(const QString &destUri, const
     Q_UNUSED(srcUri);
     m_last_page->m_current_count++;
     auto c = m_last_page->m_current_count;
-    auto t = m_current_count;
+    auto t = qMax<qint64>(m_current_count, 1);
     auto v = qreal(c*1.0/t)*100;
     //use wizard's m_current_count as total count of files need rollback.
     m_last_page->m_progress_bar->setValue(int(v));
@@ -231,32 +213,73 @@ void FileOperationProgressWizard::onFileRollbacked(const QString &destUri, const
 
 void FileOperationProgressWizard::updateProgress(const QString &srcUri, const QString &destUri, quint64 current, quint64 total)
 {
-    if (m_delayer->isActive()) {
-        return;
-    }
-    m_delayer->start();
-
-    if (m_second_page->m_state_line->text() == "unknown") {
-        m_second_page->m_state_line->setText(tr("copying..."));
-    }
+    Q_UNUSED(current)
+    Q_UNUSED(total)
     m_second_page->m_src_line->setText(srcUri);
     m_second_page->m_dest_line->setText(destUri);
+}
 
-    char *current_format_size = g_format_size (quint64(current));
-    char *total_format_size = g_format_size(quint64(m_total_size));
-    m_second_page->m_state_line->setText(tr("%1 done, %2 total, %3 of %4.").
-                                         arg(current_format_size).arg(total_format_size)
-                                         .arg(m_current_count).arg(m_total_count));
-
-    g_free(current_format_size);
-    g_free(total_format_size);
-    m_second_page->m_src_line->setText(srcUri);
-    m_second_page->m_dest_line->setText(destUri);
-    double test = (m_current_size*1.0/m_total_size)*100;
-    m_second_page->m_progress_bar->setValue(int(test));
+void FileOperationProgressWizard::sampleProgress()
+{
+    if (!m_progress)
+        return;
 
-    double progress = current*1.0/total;
-    m_second_page->m_progress_bar->setValue(int(progress*100));
+    m_total_size = m_progress->totalSize();
+    m_total_count = m_progress->totalCount();
+    m_current_size = m_progress->currentSize();
+    m_current_count = m_progress->currentCount();
+
+    qint64 now = m_progress->elapsed();
+    if (m_last_sample_time >= 0 && now > m_last_sample_time) {
+        double seconds = (now - m_last_sample_time)/1000.0;
+        double bytesPerSecond = (m_current_size - m_last_sample_size)/seconds;
+        double filesPerSecond = (m_current_count - m_last_sample_count)/seconds;
+        //smooth the speed, so that the remaining time does not jump.
+        m_bytes_per_second = m_bytes_per_second > 0? 0.7*m_bytes_per_second + 0.3*bytesPerSecond: bytesPerSecond;
+        m_files_per_second = m_files_per_second > 0? 0.7*m_files_per_second + 0.3*filesPerSecond: filesPerSecond;
+    }
+    m_last_sample_time = now;
+    m_last_sample_size = m_current_size;
+    m_last_sample_count = m_current_count;
+
+    auto page = currentPage();
+    if (page == m_first_page) {
+        char *format_size = g_format_size(quint64(m_total_size));
+        m_first_page->m_state_line->setText(tr("%1 files, %2").arg(m_total_count).arg(format_size));
+        g_free(format_size);
+    } else if (page == m_second_page) {
+        //native move does not know the sizes, use the counts instead.
+        bool useSize = m_total_size > 0;
+        double remaining = -1;
+        if (useSize && m_bytes_per_second > 0)
+            remaining = qMax<qint64>(0, m_total_size - m_current_size)/m_bytes_per_second;
+        else if (!useSize && m_files_per_second > 0)
+            remaining = qMax<qint64>(0, m_total_count - m_current_count)/m_files_per_second;
+
+        char *current_format_size = g_format_size(quint64(m_current_size));
+        char *total_format_size = g_format_size(quint64(m_total_size));
+        char *speed_format_size = g_format_size(quint64(qMax(0.0, m_bytes_per_second)));
+        QString state = tr("%1 done, %2 total, %3 of %4.").
+                arg(current_format_size).arg(total_format_size)
+                .arg(m_current_count).arg(m_total_count);
+        state += "\n" + tr("%1/s, %2 files/s").arg(speed_format_size).arg(qMax(0.0, m_files_per_second), 0, 'f', 1);
+        if (remaining >= 0)
+            state += ", " + tr("%1 left").arg(QTime(0, 0).addSecs(int(remaining)).toString("hh:mm:ss"));
+        m_second_page->m_state_line->setText(state);
+        g_free(current_format_size);
+        g_free(total_format_size);
+        g_free(speed_format_size);
+
+        double progress = 0;
+        if (useSize)
+            progress = m_current_size*1.0/m_total_size;
+        else if (m_total_count > 0)
+            progress = m_current_count*1.0/m_total_count;
+        m_second_page->m_progress_bar->setValue(qBound(0, int(progress*100), 100));
+    } else if (page == m_third_page) {
+        if (m_total_count > 0)
+            m_third_page->m_progress_bar->setValue(qBound(0, int(m_progress->clearedCount()*100.0/m_total_count), 100));
+    }
 }
 
 //FileOperationPreparePage
@@ -24,9 +24,15 @@
 #define FILEOPERATIONPROGRESSWIZARD_H
 
 #include <QWizard>
+#include <memory>
 
 #include "peony-core_global.h"
 
+//in milliseconds.
+#ifndef PEONY_PROGRESS_SAMPLE_INTERVAL
+#define PEONY_PROGRESS_SAMPLE_INTERVAL 250
+#endif
+
 class QLabel;
 class QProgressBar;
 
@@ -40,6 +46,7 @@ class FileOperationPreparePage;
 class FileOperationProgressPage;
 class FileOperationAfterProgressPage;
 class FileOperationRollbackPage;
+class FileOperationProgress;
 
 /*!
  * \brief The FileOperationProgressWizard class
@@ -49,6 +56,12 @@ class FileOperationRollbackPage;
  * The preparing page is used to count the source files need to be handled.
  * And the progress page is used to show the current progress of the operation.
  * </br>
+ * <br>
+ * The counts, sizes, speed and remaining time are sampled from the operation's
+ * FileOperationProgress every PEONY_PROGRESS_SAMPLE_INTERVAL milliseconds. The
+ * operation signals connected to the slots are only used for showing the uris,
+ * they are throttled by the operation.
+ * </br>
  * \note
  * This is the common interface of all kinds of file operation. If you want to
  * implement a special interface for one kind operation. you can dervied the class
@@ -70,6 +83,12 @@ public:
     explicit FileOperationProgressWizard(QWidget *parent = nullptr);
     ~FileOperationProgressWizard() override;
 
+    /*!
+     * \brief setProgress
+     * \param progress, the progress of the operation, see FileOperation::progress().
+     */
+    void setProgress(const std::shared_ptr<FileOperationProgress> &progress);
+
 Q_SIGNALS:
     void cancelled();
 
@@ -92,13 +111,23 @@ public Q_SLOTS:
 
     virtual void updateProgress(const QString &srcUri, const QString &destUri, quint64 current, quint64 total);
 
+protected Q_SLOTS:
+    virtual void sampleProgress();
+
 protected:
     void closeEvent(QCloseEvent *e) override;
 
     qint64 m_total_size = 0;
-    int m_current_size = 0;
-    int m_total_count = 0;
-    int m_current_count = 1;
+    qint64 m_current_size = 0;
+    qint64 m_total_count = 0;
+    qint64 m_current_count = 0;
+
+    std::shared_ptr<FileOperationProgress> m_progress;
+    qint64 m_last_sample_time = -1;
+    qint64 m_last_sample_size = 0;
+    qint64 m_last_sample_count = 0;
+    double m_bytes_per_second = 0;
+    double m_files_per_second = 0;
 
     FileOperationPreparePage *m_first_page = nullptr;
     FileOperationProgressPage *m_second_page = nullptr;
@@ -107,7 +136,7 @@ protected:
 
 private:
     QSystemTrayIcon *m_tray_icon = nullptr;
-    QTimer *m_delayer;
+    QTimer *m_sampler;
 };
 
 class PEONYCORESHARED_EXPORT FileOperationPreparePage : public QWizardPage
@@ -0,0 +1,63 @@
+/*
+ * Peony-Qt's Library
+ *
+ * Copyright (C) 2020, Tianjin KYLIN Information Technology Co., Ltd.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this library.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * Authors: Yue Lan <lanyue@kylinos.cn>
+ *
+ */
+
+#include "file-operation-progress.h"
+
+using namespace Peony;
+
+FileOperationProgress::FileOperationProgress()
+{
+    m_timer.start();
+    //make sure the first report of each type is sent.
+    for (auto &time : m_last_report_times) {
+        time.store(-PEONY_PROGRESS_REPORT_INTERVAL);
+    }
+}
+
+void FileOperationProgress::addTotal(qint64 size, qint64 count)
+{
+    m_total_size.fetchAndAddRelaxed(size);
+    m_total_count.fetchAndAddRelaxed(count);
+}
+
+void FileOperationProgress::addCurrent(qint64 size, qint64 count)
+{
+    m_current_size.fetchAndAddRelaxed(size);
+    if (count != 0)
+        m_current_count.fetchAndAddRelaxed(count);
+}
+
+void FileOperationProgress::addCleared(qint64 count)
+{
+    m_cleared_count.fetchAndAddRelaxed(count);
+}
+
+bool FileOperationProgress::tryReport(ReportType type)
+{
+    qint64 now = m_timer.elapsed();
+    auto &lastTime = m_last_report_times[type];
+    qint64 last = lastTime.load();
+    if (now - last < PEONY_PROGRESS_REPORT_INTERVAL)
+        return false;
+    //only one of the threads reaching here at the same time wins.
+    return lastTime.testAndSetRelaxed(last, now);
+}
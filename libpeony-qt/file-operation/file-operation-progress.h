@@ -0,0 +1,108 @@
+/*
+ * Peony-Qt's Library
+ *
+ * Copyright (C) 2020, Tianjin KYLIN Information Technology Co., Ltd.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this library.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * Authors: Yue Lan <lanyue@kylinos.cn>
+ *
+ */
+
+#ifndef FILEOPERATIONPROGRESS_H
+#define FILEOPERATIONPROGRESS_H
+
+#include <QAtomicInteger>
+#include <QElapsedTimer>
+
+#include "peony-core_global.h"
+
+//in milliseconds.
+#ifndef PEONY_PROGRESS_REPORT_INTERVAL
+#define PEONY_PROGRESS_REPORT_INTERVAL 100
+#endif
+
+namespace Peony {
+
+/*!
+ * \brief The FileOperationProgress class
+ * <br>
+ * A lock-free accumulator of a file operation's progress. The operation and its
+ * workers add the counts and sizes, and the ui samples them at a fixed rate,
+ * so the ui traffic does not grow with the count of files.
+ * </br>
+ * <br>
+ * The operation signals which carry uris, such as operationPreparedOne(), are
+ * only sent once per PEONY_PROGRESS_REPORT_INTERVAL milliseconds for each kind,
+ * see tryReport(). Do not count these signals, sample this class instead.
+ * </br>
+ * \note The progress is shared by the operation and the ui, because the operation
+ * is deleted once it finished, but the ui might still sample it.
+ */
+class PEONYCORESHARED_EXPORT FileOperationProgress
+{
+public:
+    enum ReportType {
+        Prepared,
+        Progressed,
+        Cleared,
+        ReportTypeCount
+    };
+
+    FileOperationProgress();
+
+    void addTotal(qint64 size, qint64 count = 1);
+    /*!
+     * \brief addCurrent
+     * \param size, the bytes handled since last call, not the offset of current file.
+     * \param count, the files finished.
+     */
+    void addCurrent(qint64 size, qint64 count = 0);
+    void addCleared(qint64 count = 1);
+
+    qint64 totalSize() {return m_total_size.load();}
+    qint64 totalCount() {return m_total_count.load();}
+    qint64 currentSize() {return m_current_size.load();}
+    qint64 currentCount() {return m_current_count.load();}
+    qint64 clearedCount() {return m_cleared_count.load();}
+
+    /*!
+     * \brief elapsed
+     * \return milliseconds since the progress created.
+     */
+    qint64 elapsed() {return m_timer.elapsed();}
+
+    /*!
+     * \brief tryReport
+     * \param type
+     * \return true if the signal of this type should be sent now.
+     * It returns true at most once per PEONY_PROGRESS_REPORT_INTERVAL
+     * milliseconds for each type, no matter which thread calls it.
+     */
+    bool tryReport(ReportType type);
+
+private:
+    QAtomicInteger<qint64> m_total_size = 0;
+    QAtomicInteger<qint64> m_total_count = 0;
+    QAtomicInteger<qint64> m_current_size = 0;
+    QAtomicInteger<qint64> m_current_count = 0;
+    QAtomicInteger<qint64> m_cleared_count = 0;
+
+    QAtomicInteger<qint64> m_last_report_times[ReportTypeCount];
+    QElapsedTimer m_timer;
+};
+
+}
+
+#endif // FILEOPERATIONPROGRESS_H
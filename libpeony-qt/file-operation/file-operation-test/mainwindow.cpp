@@ -142,6 +142,7 @@ MainWindow::MainWindow(QWidget *parent)
 */
 
         Peony::FileOperationProgressWizard *wizard = new Peony::FileOperationProgressWizard;
+        wizard->setProgress(moveOp->progress());
         wizard->connect(moveOp, &Peony::FileOperation::operationStarted,
                         wizard, &Peony::FileOperationProgressWizard::show, Qt::BlockingQueuedConnection);
         wizard->connect(moveOp, &Peony::FileOperation::operationPreparedOne,
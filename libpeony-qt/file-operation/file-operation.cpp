@@ -27,6 +27,7 @@ using namespace Peony;
 FileOperation::FileOperation(QObject *parent) : QObject (parent)
 {
     m_cancellable_wrapper = wrapGCancellable(g_cancellable_new());
+    m_progress = std::make_shared<FileOperationProgress>();
     setAutoDelete(true);
 }
 
@@ -45,3 +46,34 @@ void FileOperation::cancel()
     g_cancellable_cancel(m_cancellable_wrapper.get()->get());
     m_is_cancelled = true;
 }
+
+void FileOperation::notifyPreparedOne(const QString &srcUri, qint64 size)
+{
+    m_progress->addTotal(size);
+    if (m_progress->tryReport(FileOperationProgress::Prepared))
+        Q_EMIT operationPreparedOne(srcUri, size);
+}
+
+void FileOperation::notifyFileProgress(const QString &srcUri, const QString &destUri, qint64 bytes)
+{
+    m_progress->addCurrent(bytes);
+    if (m_progress->tryReport(FileOperationProgress::Progressed)) {
+        Q_EMIT FileProgressCallback(srcUri, destUri,
+                                    m_progress->currentSize(),
+                                    m_progress->totalSize());
+    }
+}
+
+void FileOperation::notifyProgressedOne(const QString &srcUri, const QString &destUri, qint64 size, qint64 notifiedBytes)
+{
+    m_progress->addCurrent(size - notifiedBytes, 1);
+    if (m_progress->tryReport(FileOperationProgress::Progressed))
+        Q_EMIT operationProgressedOne(srcUri, destUri, size);
+}
+
+void FileOperation::notifyAfterProgressedOne(const QString &srcUri)
+{
+    m_progress->addCleared();
+    if (m_progress->tryReport(FileOperationProgress::Cleared))
+        Q_EMIT operationAfterProgressedOne(srcUri);
+}
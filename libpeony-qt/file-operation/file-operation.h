@@ -28,6 +28,7 @@
 
 #include "gerror-wrapper.h"
 #include "gobject-template.h"
+#include "file-operation-progress.h"
 
 #include <QMetaType>
 #include <QHash>
@@ -112,6 +113,13 @@ public:
 
     bool isCancelled() {return m_is_cancelled;}
 
+    /*!
+     * \brief progress
+     * \return the accumulated progress of this operation.
+     * \see FileOperationProgress.
+     */
+    std::shared_ptr<FileOperationProgress> progress() {return m_progress;}
+
 Q_SIGNALS:
     /*!
      * \brief invalidOperation
@@ -281,7 +289,32 @@ public Q_SLOTS:
 protected:
     GCancellableWrapperPtr getCancellable(){return m_cancellable_wrapper;}
 
+    /*!
+     * \brief notifyPreparedOne
+     * <br>
+     * Add a found file to the progress, and send operationPreparedOne()
+     * if it has not been sent recently.
+     * The notify methods are thread safe.
+     * </br>
+     */
+    void notifyPreparedOne(const QString &srcUri, qint64 size);
+    /*!
+     * \brief notifyFileProgress
+     * \param bytes, the bytes handled since last notify of the same file.
+     */
+    void notifyFileProgress(const QString &srcUri, const QString &destUri, qint64 bytes);
+    /*!
+     * \brief notifyProgressedOne
+     * \param size, the size of the file.
+     * \param notifiedBytes, the bytes of this file which have been notified
+     * by notifyFileProgress().
+     */
+    void notifyProgressedOne(const QString &srcUri, const QString &destUri, qint64 size, qint64 notifiedBytes = 0);
+    void notifyAfterProgressedOne(const QString &srcUri);
+
 private:
+    std::shared_ptr<FileOperationProgress> m_progress;
+
     GCancellableWrapperPtr m_cancellable_wrapper = nullptr;
     bool m_is_cancelled = false;
     bool m_reversible = false;
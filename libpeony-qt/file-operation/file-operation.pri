@@ -20,7 +20,10 @@ HEADERS += \
     $$PWD/file-untrash-operation.h \
     $$PWD/file-rename-operation.h \
     $$PWD/file-count-operation.h \
-    $$PWD/create-template-operation.h
+    $$PWD/create-template-operation.h \
+    $$PWD/local-file-copier.h \
+    $$PWD/file-tree-walker.h \
+    $$PWD/file-operation-progress.h
 
 SOURCES += \
     $$PWD/file-operation.cpp \
@@ -37,4 +40,7 @@ SOURCES += \
     $$PWD/file-untrash-operation.cpp \
     $$PWD/file-rename-operation.cpp \
     $$PWD/file-count-operation.cpp \
-    $$PWD/create-template-operation.cpp
+    $$PWD/create-template-operation.cpp \
+    $$PWD/local-file-copier.cpp \
+    $$PWD/file-tree-walker.cpp \
+    $$PWD/file-operation-progress.cpp
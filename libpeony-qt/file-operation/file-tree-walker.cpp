@@ -0,0 +1,173 @@
+/*
+ * Peony-Qt's Library
+ *
+ * Copyright (C) 2020, Tianjin KYLIN Information Technology Co., Ltd.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this library.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * Authors: Yue Lan <lanyue@kylinos.cn>
+ *
+ */
+
+#include "file-tree-walker.h"
+#include "file-node-reporter.h"
+
+#define WALKER_QUERY_ATTRIBUTES G_FILE_ATTRIBUTE_STANDARD_NAME "," \
+    G_FILE_ATTRIBUTE_STANDARD_TYPE "," \
+    G_FILE_ATTRIBUTE_STANDARD_SIZE
+
+using namespace Peony;
+
+FileTreeWalker::FileTreeWalker(const QString &rootUri, GCancellable *cancellable)
+{
+    m_root_uri = rootUri;
+    if (cancellable)
+        m_cancellable = G_CANCELLABLE(g_object_ref(cancellable));
+}
+
+FileTreeWalker::~FileTreeWalker()
+{
+    if (m_info)
+        g_object_unref(m_info);
+    if (m_pending_folder)
+        g_object_unref(m_pending_folder);
+    for (auto level : m_stack) {
+        if (level.enumerator) {
+            g_file_enumerator_close(level.enumerator, nullptr, nullptr);
+            g_object_unref(level.enumerator);
+        }
+        g_object_unref(level.folder);
+    }
+    if (m_cancellable)
+        g_object_unref(m_cancellable);
+}
+
+bool FileTreeWalker::next()
+{
+    if (m_info) {
+        g_object_unref(m_info);
+        m_info = nullptr;
+    }
+
+    if (!m_started) {
+        m_started = true;
+        GFile *root = g_file_new_for_uri(m_root_uri.toUtf8().constData());
+        m_uri = m_root_uri;
+        //the root is reported even if it could not be queried, so that
+        //the operation can get the error when handling it.
+        m_info = g_file_query_info(root,
+                                   WALKER_QUERY_ATTRIBUTES,
+                                   G_FILE_QUERY_INFO_NOFOLLOW_SYMLINKS,
+                                   m_cancellable,
+                                   nullptr);
+        if (m_info && g_file_info_get_file_type(m_info) == G_FILE_TYPE_DIRECTORY) {
+            m_event = EnterFolder;
+            m_pending_folder = root;
+        } else {
+            m_event = File;
+            g_object_unref(root);
+        }
+        return true;
+    }
+
+    if (m_pending_folder) {
+        Level level;
+        level.folder = m_pending_folder;
+        level.enumerator = nullptr;
+        level.uri = m_uri;
+        if (!m_skip_children) {
+            level.enumerator = g_file_enumerate_children(m_pending_folder,
+                                                         WALKER_QUERY_ATTRIBUTES,
+                                                         G_FILE_QUERY_INFO_NOFOLLOW_SYMLINKS,
+                                                         m_cancellable,
+                                                         nullptr);
+        }
+        m_pending_folder = nullptr;
+        m_stack.append(level);
+    }
+    m_skip_children = false;
+
+    if (m_stack.isEmpty()) {
+        m_event = Invalid;
+        return false;
+    }
+
+    Level level = m_stack.last();
+    GFileInfo *info = nullptr;
+    if (level.enumerator)
+        info = g_file_enumerator_next_file(level.enumerator, m_cancellable, nullptr);
+
+    if (!info) {
+        //all children are walked.
+        m_stack.removeLast();
+        if (level.enumerator) {
+            g_file_enumerator_close(level.enumerator, nullptr, nullptr);
+            g_object_unref(level.enumerator);
+        }
+        g_object_unref(level.folder);
+        m_event = LeaveFolder;
+        m_uri = level.uri;
+        return true;
+    }
+
+    GFile *child = g_file_get_child(level.folder, g_file_info_get_name(info));
+    char *uri = g_file_get_uri(child);
+    m_uri = uri;
+    g_free(uri);
+    m_info = info;
+    if (g_file_info_get_file_type(info) == G_FILE_TYPE_DIRECTORY) {
+        m_event = EnterFolder;
+        m_pending_folder = child;
+    } else {
+        m_event = File;
+        g_object_unref(child);
+    }
+    return true;
+}
+
+FileTreeScanner::FileTreeScanner(const QStringList &uris, FileNodeReporter *reporter)
+{
+    setAutoDelete(false);
+    m_uris = uris;
+    m_reporter = reporter;
+    m_cancellable = g_cancellable_new();
+}
+
+FileTreeScanner::~FileTreeScanner()
+{
+    g_object_unref(m_cancellable);
+}
+
+void FileTreeScanner::run()
+{
+    for (auto uri : m_uris) {
+        FileTreeWalker walker(uri, m_cancellable);
+        while (walker.next()) {
+            if (g_cancellable_is_cancelled(m_cancellable))
+                return;
+            if (m_reporter && m_reporter->isOperationCancelled())
+                return;
+            if (walker.event() == FileTreeWalker::LeaveFolder)
+                continue;
+
+            if (m_reporter)
+                m_reporter->sendNodeFound(walker.uri(), walker.size());
+        }
+    }
+}
+
+void FileTreeScanner::stop()
+{
+    g_cancellable_cancel(m_cancellable);
+}
@@ -0,0 +1,140 @@
+/*
+ * Peony-Qt's Library
+ *
+ * Copyright (C) 2020, Tianjin KYLIN Information Technology Co., Ltd.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this library.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * Authors: Yue Lan <lanyue@kylinos.cn>
+ *
+ */
+
+#ifndef FILETREEWALKER_H
+#define FILETREEWALKER_H
+
+#include <QString>
+#include <QStringList>
+#include <QVector>
+#include <QRunnable>
+
+#include <gio/gio.h>
+
+namespace Peony {
+
+class FileNodeReporter;
+
+/*!
+ * \brief The FileTreeWalker class
+ * <br>
+ * Walk a file tree in depth-first order without building the tree. Only the
+ * enumerators of the folders being walked are kept, so the memory used is
+ * proportional to the depth of the tree, not to the count of files.
+ * </br>
+ * <br>
+ * Every call of next() moves to the next event. A folder has an EnterFolder
+ * event before its children and a LeaveFolder event after them, so that the
+ * walker can be used in both pre-order (copying) and post-order (deleting).
+ * </br>
+ * \note Symbolic links are not followed. Folders which could not be enumerated
+ * are walked as empty folders.
+ */
+class FileTreeWalker
+{
+public:
+    enum Event {
+        Invalid,
+        File,
+        EnterFolder,
+        LeaveFolder
+    };
+
+    explicit FileTreeWalker(const QString &rootUri, GCancellable *cancellable = nullptr);
+    ~FileTreeWalker();
+
+    bool next();
+
+    Event event() {return m_event;}
+    const QString uri() {return m_uri;}
+    /*!
+     * \brief info
+     * \return the info of the current file, it contains standard::name,
+     * standard::type and standard::size. It is only valid until next(),
+     * and it is null for LeaveFolder events or if the root could not be queried.
+     */
+    GFileInfo *info() {return m_info;}
+    qint64 size() {return m_info? g_file_info_get_size(m_info): 0;}
+    /*!
+     * \brief depth
+     * \return 0 for the root, 1 for the root's children, and so on.
+     */
+    int depth() {return m_stack.count();}
+
+    /*!
+     * \brief skipChildren
+     * <br>
+     * Called after an EnterFolder event, the next event will be the LeaveFolder
+     * event of the same folder.
+     * </br>
+     */
+    void skipChildren() {m_skip_children = true;}
+
+private:
+    struct Level {
+        GFile *folder;
+        GFileEnumerator *enumerator;
+        QString uri;
+    };
+
+    QString m_root_uri;
+    GCancellable *m_cancellable = nullptr;
+    bool m_started = false;
+    bool m_skip_children = false;
+
+    QVector<Level> m_stack;
+    GFile *m_pending_folder = nullptr;
+
+    Event m_event = Invalid;
+    QString m_uri;
+    GFileInfo *m_info = nullptr;
+};
+
+/*!
+ * \brief The FileTreeScanner class
+ * <br>
+ * Count the files and the total size of the trees in a worker thread,
+ * so that an operation can start handling the files without waiting for
+ * the counting. Every file found is reported by the reporter, which adds
+ * it to the operation's progress.
+ * </br>
+ * \note The scanner is not auto deleted, it should be stopped and waited
+ * before it is destroyed.
+ */
+class FileTreeScanner : public QRunnable
+{
+public:
+    explicit FileTreeScanner(const QStringList &uris, FileNodeReporter *reporter);
+    ~FileTreeScanner() override;
+
+    void run() override;
+    void stop();
+
+private:
+    QStringList m_uris;
+    FileNodeReporter *m_reporter = nullptr;
+    GCancellable *m_cancellable = nullptr;
+};
+
+}
+
+#endif // FILETREEWALKER_H
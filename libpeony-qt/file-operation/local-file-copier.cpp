@@ -0,0 +1,377 @@
+/*
+ * Peony-Qt's Library
+ *
+ * Copyright (C) 2020, Tianjin KYLIN Information Technology Co., Ltd.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this library.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * Authors: Yue Lan <lanyue@kylinos.cn>
+ *
+ */
+
+#include "local-file-copier.h"
+
+#include <QByteArray>
+
+#ifdef __linux__
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/ioctl.h>
+#include <sys/sendfile.h>
+#include <sys/syscall.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <errno.h>
+#include <stdlib.h>
+
+//from linux/fs.h, which conflicts with other system headers.
+#ifndef FICLONE
+#define FICLONE _IOW(0x94, 9, int)
+#endif
+#endif
+
+using namespace Peony;
+
+#ifdef __linux__
+
+namespace {
+
+enum CopyResult {
+    Copied,
+    Unsupported,
+    Failed
+};
+
+struct ProgressReporter {
+    GFileProgressCallback callback;
+    gpointer data;
+    goffset total;
+    gint64 last_time;
+
+    void report(goffset current, bool force) {
+        if (!callback)
+            return;
+        gint64 now = g_get_monotonic_time();
+        if (!force && now - last_time < PEONY_LOCAL_COPY_PROGRESS_INTERVAL*1000)
+            return;
+        last_time = now;
+        callback(current, total, data);
+    }
+};
+
+QByteArray pathOf(GFile *file)
+{
+    char *path = g_file_get_path(file);
+    QByteArray result = path;
+    g_free(path);
+    return result;
+}
+
+void setErrorFromErrno(GError **error, int errsv, const char *message)
+{
+    g_set_error(error, G_IO_ERROR, g_io_error_from_errno(errsv), "%s: %s", message, g_strerror(errsv));
+}
+
+bool isUnsupportedErrno(int errsv)
+{
+    switch (errsv) {
+    case ENOSYS:
+    case EXDEV:
+    case EINVAL:
+    case EBADF:
+    case EOPNOTSUPP:
+#if ENOTSUP != EOPNOTSUPP
+    case ENOTSUP:
+#endif
+        return true;
+    default:
+        return false;
+    }
+}
+
+CopyResult cloneFile(int srcFd, int destFd, ProgressReporter &reporter)
+{
+    if (ioctl(destFd, FICLONE, srcFd) != 0)
+        return Unsupported;
+    reporter.report(reporter.total, true);
+    return Copied;
+}
+
+CopyResult copyByCopyFileRange(int srcFd, int destFd, GCancellable *cancellable, ProgressReporter &reporter, GError **error)
+{
+#ifdef __NR_copy_file_range
+    goffset copied = 0;
+    while (true) {
+        if (g_cancellable_set_error_if_cancelled(cancellable, error))
+            return Failed;
+
+        //use the syscall directly, the glibc wrapper is not available before 2.27.
+        auto n = syscall(__NR_copy_file_range, srcFd, nullptr, destFd, nullptr,
+                         size_t(PEONY_LOCAL_COPY_CHUNK_SIZE), 0u);
+        if (n < 0) {
+            int errsv = errno;
+            if (errsv == EINTR)
+                continue;
+            if (copied == 0 && isUnsupportedErrno(errsv))
+                return Unsupported;
+            setErrorFromErrno(error, errsv, "Error copying file");
+            return Failed;
+        }
+        if (n == 0)
+            break;
+        copied += n;
+        reporter.report(copied, false);
+    }
+    reporter.report(copied, true);
+    return Copied;
+#else
+    Q_UNUSED(srcFd) Q_UNUSED(destFd) Q_UNUSED(cancellable) Q_UNUSED(reporter) Q_UNUSED(error)
+    return Unsupported;
+#endif
+}
+
+CopyResult copyBySendfile(int srcFd, int destFd, GCancellable *cancellable, ProgressReporter &reporter, GError **error)
+{
+    goffset copied = 0;
+    while (true) {
+        if (g_cancellable_set_error_if_cancelled(cancellable, error))
+            return Failed;
+
+        auto n = sendfile(destFd, srcFd, nullptr, PEONY_LOCAL_COPY_CHUNK_SIZE);
+        if (n < 0) {
+            int errsv = errno;
+            if (errsv == EINTR)
+                continue;
+            if (copied == 0 && isUnsupportedErrno(errsv))
+                return Unsupported;
+            setErrorFromErrno(error, errsv, "Error copying file");
+            return Failed;
+        }
+        if (n == 0)
+            break;
+        copied += n;
+        reporter.report(copied, false);
+    }
+    reporter.report(copied, true);
+    return Copied;
+}
+
+bool copyByBuffer(int srcFd, int destFd, GCancellable *cancellable, ProgressReporter &reporter, GError **error)
+{
+    void *buffer = nullptr;
+    //aligned to page size, so that the kernel can copy the pages efficiently.
+    if (posix_memalign(&buffer, 4096, PEONY_LOCAL_COPY_BUFFER_SIZE) != 0) {
+        setErrorFromErrno(error, ENOMEM, "Error copying file");
+        return false;
+    }
+    posix_fadvise(srcFd, 0, 0, POSIX_FADV_SEQUENTIAL);
+
+    bool success = true;
+    goffset copied = 0;
+    while (success) {
+        if (g_cancellable_set_error_if_cancelled(cancellable, error)) {
+            success = false;
+            break;
+        }
+
+        auto n = read(srcFd, buffer, PEONY_LOCAL_COPY_BUFFER_SIZE);
+        if (n < 0) {
+            if (errno == EINTR)
+                continue;
+            setErrorFromErrno(error, errno, "Error reading from file");
+            success = false;
+            break;
+        }
+        if (n == 0)
+            break;
+
+        auto p = static_cast<const char *>(buffer);
+        auto left = n;
+        while (left > 0) {
+            auto written = write(destFd, p, size_t(left));
+            if (written < 0) {
+                if (errno == EINTR)
+                    continue;
+                setErrorFromErrno(error, errno, "Error writing to file");
+                success = false;
+                break;
+            }
+            p += written;
+            left -= written;
+        }
+        copied += n;
+        reporter.report(copied, false);
+    }
+    free(buffer);
+
+    if (success)
+        reporter.report(copied, true);
+    return success;
+}
+
+bool copyContent(int srcFd, int destFd, goffset size, GCancellable *cancellable, ProgressReporter &reporter, GError **error)
+{
+    //files reporting zero size might still have content, such as the ones in procfs,
+    //only a read loop can copy them correctly.
+    if (size > 0) {
+        if (cloneFile(srcFd, destFd, reporter) == Copied)
+            return true;
+
+        auto result = copyByCopyFileRange(srcFd, destFd, cancellable, reporter, error);
+        if (result != Unsupported)
+            return result == Copied;
+
+        result = copyBySendfile(srcFd, destFd, cancellable, reporter, error);
+        if (result != Unsupported)
+            return result == Copied;
+    }
+    return copyByBuffer(srcFd, destFd, cancellable, reporter, error);
+}
+
+}
+
+#endif
+
+bool LocalFileCopier::canCopy(GFile *source, GFile *destination, GFileCopyFlags flags)
+{
+#ifdef __linux__
+    if (flags & G_FILE_COPY_BACKUP)
+        return false;
+    if (!g_file_is_native(source) || !g_file_is_native(destination))
+        return false;
+
+    auto srcPath = pathOf(source);
+    auto destPath = pathOf(destination);
+    if (srcPath.isEmpty() || destPath.isEmpty())
+        return false;
+
+    struct stat st;
+    int ret = (flags & G_FILE_COPY_NOFOLLOW_SYMLINKS)? lstat(srcPath.constData(), &st): stat(srcPath.constData(), &st);
+    return ret == 0 && S_ISREG(st.st_mode);
+#else
+    Q_UNUSED(source) Q_UNUSED(destination) Q_UNUSED(flags)
+    return false;
+#endif
+}
+
+gboolean LocalFileCopier::copy(GFile *source,
+                               GFile *destination,
+                               GFileCopyFlags flags,
+                               GCancellable *cancellable,
+                               GFileProgressCallback progress_callback,
+                               gpointer progress_callback_data,
+                               GError **error)
+{
+    if (!canCopy(source, destination, flags))
+        return g_file_copy(source, destination, flags, cancellable,
+                           progress_callback, progress_callback_data, error);
+
+#ifdef __linux__
+    if (g_cancellable_set_error_if_cancelled(cancellable, error))
+        return FALSE;
+
+    auto srcPath = pathOf(source);
+    auto destPath = pathOf(destination);
+
+    int openFlags = O_RDONLY|O_CLOEXEC;
+    if (flags & G_FILE_COPY_NOFOLLOW_SYMLINKS)
+        openFlags |= O_NOFOLLOW;
+    int srcFd = open(srcPath.constData(), openFlags);
+    if (srcFd < 0) {
+        setErrorFromErrno(error, errno, "Error opening file");
+        return FALSE;
+    }
+
+    struct stat srcStat;
+    if (fstat(srcFd, &srcStat) != 0 || !S_ISREG(srcStat.st_mode)) {
+        //the file was replaced after canCopy(), let gio handle it.
+        close(srcFd);
+        return g_file_copy(source, destination, flags, cancellable,
+                           progress_callback, progress_callback_data, error);
+    }
+
+    ProgressReporter reporter = {progress_callback, progress_callback_data, srcStat.st_size, 0};
+
+    //when a file is overwritten, the content is written to a temporary file
+    //and renamed over it at last, so the file is kept if the copy fails.
+    QByteArray writePath = destPath;
+    bool replacing = false;
+    if (flags & G_FILE_COPY_OVERWRITE) {
+        struct stat destStat;
+        if (lstat(destPath.constData(), &destStat) == 0) {
+            if (S_ISDIR(destStat.st_mode)) {
+                close(srcFd);
+                g_set_error_literal(error, G_IO_ERROR, G_IO_ERROR_IS_DIRECTORY, "Can’t copy over directory");
+                return FALSE;
+            }
+            if (destStat.st_dev == srcStat.st_dev && destStat.st_ino == srcStat.st_ino) {
+                //overwriting a file with itself, the content is already there.
+                close(srcFd);
+                reporter.report(srcStat.st_size, true);
+                return TRUE;
+            }
+            if (flags & G_FILE_COPY_TARGET_DEFAULT_PERMS) {
+                //the default permissions of a temporary file are unknown, let gio do it.
+                close(srcFd);
+                return g_file_copy(source, destination, flags, cancellable,
+                                   progress_callback, progress_callback_data, error);
+            }
+            replacing = true;
+        }
+    }
+
+    int destFd = -1;
+    if (replacing) {
+        int slash = destPath.lastIndexOf('/');
+        writePath = destPath.left(slash + 1) + "." + destPath.mid(slash + 1) + ".XXXXXX";
+        destFd = mkostemp(writePath.data(), O_CLOEXEC);
+    } else {
+        //the permissions are set by g_file_copy_attributes() later.
+        mode_t mode = (flags & G_FILE_COPY_TARGET_DEFAULT_PERMS)? 0666: 0600;
+        destFd = open(destPath.constData(), O_WRONLY|O_CREAT|O_EXCL|O_CLOEXEC, mode);
+    }
+    if (destFd < 0) {
+        int errsv = errno;
+        close(srcFd);
+        if (errsv == EEXIST)
+            g_set_error_literal(error, G_IO_ERROR, G_IO_ERROR_EXISTS, "Target file exists");
+        else
+            setErrorFromErrno(error, errsv, "Error opening file");
+        return FALSE;
+    }
+
+    bool success = copyContent(srcFd, destFd, srcStat.st_size, cancellable, reporter, error);
+    close(srcFd);
+    if (close(destFd) != 0 && success) {
+        setErrorFromErrno(error, errno, "Error closing file");
+        success = false;
+    }
+    if (success && replacing && rename(writePath.constData(), destPath.constData()) != 0) {
+        setErrorFromErrno(error, errno, "Error renaming temporary file");
+        success = false;
+    }
+
+    if (!success) {
+        //do not leave a partial file.
+        unlink(writePath.constData());
+        return FALSE;
+    }
+
+    //errors of attributes are not fatal, gio ignores them too.
+    g_file_copy_attributes(source, destination, flags, cancellable, nullptr);
+    return TRUE;
+#else
+    return FALSE;
+#endif
+}
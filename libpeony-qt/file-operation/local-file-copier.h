@@ -0,0 +1,84 @@
+/*
+ * Peony-Qt's Library
+ *
+ * Copyright (C) 2020, Tianjin KYLIN Information Technology Co., Ltd.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this library.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * Authors: Yue Lan <lanyue@kylinos.cn>
+ *
+ */
+
+#ifndef LOCALFILECOPIER_H
+#define LOCALFILECOPIER_H
+
+#include <gio/gio.h>
+
+#ifndef PEONY_LOCAL_COPY_CHUNK_SIZE
+#define PEONY_LOCAL_COPY_CHUNK_SIZE (16*1024*1024)
+#endif
+
+#ifndef PEONY_LOCAL_COPY_BUFFER_SIZE
+#define PEONY_LOCAL_COPY_BUFFER_SIZE (1024*1024)
+#endif
+
+//in milliseconds.
+#ifndef PEONY_LOCAL_COPY_PROGRESS_INTERVAL
+#define PEONY_LOCAL_COPY_PROGRESS_INTERVAL 100
+#endif
+
+namespace Peony {
+
+/*!
+ * \brief The LocalFileCopier class
+ * <br>
+ * A drop-in replacement of g_file_copy() for regular files on local file systems.
+ * It lets the kernel do the work instead of reading and writing the content in
+ * user space, the methods are tried in this order:
+ * 1. FICLONE, share the extents on the file systems supporting reflink (btrfs, xfs),
+ * 2. copy_file_range(), copy in kernel, within and across file systems,
+ * 3. sendfile(), for the kernels which do not have copy_file_range(),
+ * 4. read() and write() with a large aligned buffer.
+ * </br>
+ * <br>
+ * The progress callback is called at most once per PEONY_LOCAL_COPY_PROGRESS_INTERVAL
+ * milliseconds, and once more when the copy is finished. The attributes are copied
+ * by g_file_copy_attributes() with the same flags, so the metadata of the copied
+ * file is the same as g_file_copy()'s.
+ * </br>
+ * \note For the files which are not supported, such as remote files, symbolic links
+ * or special files, copy() falls back to g_file_copy().
+ */
+class LocalFileCopier
+{
+public:
+    static bool canCopy(GFile *source, GFile *destination, GFileCopyFlags flags);
+
+    /*!
+     * \brief copy
+     * \return TRUE on success, FALSE with \a error set otherwise.
+     * \see g_file_copy().
+     */
+    static gboolean copy(GFile *source,
+                         GFile *destination,
+                         GFileCopyFlags flags,
+                         GCancellable *cancellable,
+                         GFileProgressCallback progress_callback,
+                         gpointer progress_callback_data,
+                         GError **error);
+};
+
+}
+
+#endif // LOCALFILECOPIER_H
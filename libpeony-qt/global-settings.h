@@ -35,6 +35,9 @@
 #define SORT_FOLDER_FIRST "folder-first"
 #define RESIDENT_IN_BACKEND "resident"
 #define LAST_DESKTOP_SORT_ORDER "last-desktop-sort-order"
+#define FILE_INFO_CACHE_SIZE "file-info-cache-size"
+#define THUMBNAIL_CACHE_SIZE "thumbnail-cache-size"
+#define SEARCH_FILE_INDEX "search-file-index"
 
 //gsettings
 #define SIDEBAR_BG_OPACITY "sidebar-bg-opacity"
@@ -34,9 +34,16 @@
 
 #include "file-operation-utils.h"
 
+#ifndef PEONY_MODEL_UPDATE_INTERVAL
+#define PEONY_MODEL_UPDATE_INTERVAL 16
+#endif
+
 #include <QIcon>
 #include <QMimeData>
 #include <QUrl>
+#include <QTimer>
+
+#include <algorithm>
 
 #include <QDebug>
 
@@ -45,6 +52,11 @@ using namespace Peony;
 FileItemModel::FileItemModel(QObject *parent) : QAbstractItemModel (parent)
 {
     setPositiveResponse(true);
+
+    m_update_timer = new QTimer(this);
+    m_update_timer->setSingleShot(true);
+    m_update_timer->setInterval(PEONY_MODEL_UPDATE_INTERVAL);
+    connect(m_update_timer, &QTimer::timeout, this, &FileItemModel::flushItemUpdates);
 }
 
 FileItemModel::~FileItemModel()
@@ -76,6 +88,10 @@ void FileItemModel::setRootUri(const QString &uri)
 void FileItemModel::setRootItem(FileItem *item)
 {
     beginResetModel();
+    //the pending updates belong to the old root's children.
+    m_update_timer->stop();
+    m_pending_update_items.clear();
+    m_pending_decoration_items.clear();
     m_root_item->deleteLater();
 
     m_root_item = item;
@@ -107,57 +123,93 @@ FileItem *FileItemModel::itemFromIndex(const QModelIndex &index) const
 QModelIndex FileItemModel::firstColumnIndex(FileItem *item)
 {
     //root children
-    if (item->m_parent == nullptr) {
-        for (int i = 0; i < m_root_item->m_children->count(); i++) {
-            //qDebug()<<i<<item->m_info->uri()<<m_root_item->m_children->at(i)->m_info->uri();
-            if (item == m_root_item->m_children->at(i)) {
-                //qDebug()<<i<<item->m_info->uri();
-                return createIndex(i, 0, item);
-            }
-        }
+    auto siblings = item->m_parent? item->m_parent->m_children: m_root_item->m_children;
+    //the row is kept by parent item, see FileItem::appendChild().
+    int row = item->m_row;
+    if (row < 0 || row >= siblings->count() || siblings->at(row) != item)
         return QModelIndex();
-    } else {
-        //has parent item
-        for (int i = 0; i < item->m_parent->m_children->count(); i++) {
-            if (item == item->m_parent->m_children->at(i))
-                return createIndex(i, 0, item);
-        }
-        return QModelIndex();
-    }
+    return createIndex(row, 0, item);
 }
 
 QModelIndex FileItemModel::lastColumnIndex(FileItem *item)
 {
-    if (!item->m_parent) {
-        for (int i = 0; i < m_root_item->m_children->count(); i++) {
-            //qDebug()<<i<<item->m_info->uri()<<m_root_item->m_children->at(i)->m_info->uri();
-            if (item == m_root_item->m_children->at(i)) {
-                //qDebug()<<i<<item->m_info->uri();
-                return createIndex(i, Other, item);
-            }
-        }
-        return QModelIndex();
-    } else {
-        //has parent item
-        for (int i = 0; i < item->m_parent->m_children->count(); i++) {
-            if (item == item->m_parent->m_children->at(i))
-                return createIndex(i, Other, item);
-        }
+    auto siblings = item->m_parent? item->m_parent->m_children: m_root_item->m_children;
+    int row = item->m_row;
+    if (row < 0 || row >= siblings->count() || siblings->at(row) != item)
         return QModelIndex();
-    }
+    return createIndex(row, Other, item);
 }
 
 const QModelIndex FileItemModel::indexFromUri(const QString &uri)
 {
     //FIXME: support recursively finding?
-    for (auto child : *m_root_item->m_children) {
-        if (child->uri() == uri) {
-            return child->firstColumnIndex();
-        }
+    auto child = m_root_item->getChildFromUri(uri);
+    if (child) {
+        return child->firstColumnIndex();
     }
     return QModelIndex();
 }
 
+void FileItemModel::scheduleItemUpdate(FileItem *item, bool decorationOnly)
+{
+    if (!item)
+        return;
+
+    if (decorationOnly) {
+        if (!m_pending_update_items.contains(item))
+            m_pending_decoration_items.insert(item, item);
+    } else {
+        m_pending_decoration_items.remove(item);
+        m_pending_update_items.insert(item, item);
+    }
+    if (!m_update_timer->isActive())
+        m_update_timer->start();
+}
+
+void FileItemModel::flushItemUpdates()
+{
+    auto updateItems = m_pending_update_items;
+    auto decorationItems = m_pending_decoration_items;
+    m_pending_update_items.clear();
+    m_pending_decoration_items.clear();
+
+    emitItemsChanged(updateItems, QVector<int>());
+    //the sort keys are not changed, proxy model will not re-sort them.
+    emitItemsChanged(decorationItems, QVector<int>()<<Qt::DecorationRole);
+}
+
+void FileItemModel::emitItemsChanged(const QHash<FileItem*, QPointer<FileItem>> &items, const QVector<int> &roles)
+{
+    //parent item -> the rows changed.
+    QHash<FileItem*, QVector<int>> rows;
+    for (auto item : items) {
+        if (!item)
+            continue;
+        auto index = item->firstColumnIndex();
+        if (!index.isValid())
+            continue;
+        rows[item->m_parent]<<index.row();
+    }
+
+    //emit one dataChanged() for each run of continuous rows. a range covering
+    //unchanged rows would make proxy model re-sort all of them.
+    for (auto it = rows.begin(); it != rows.end(); it++) {
+        auto siblings = it.key()? it.key()->m_children: m_root_item->m_children;
+        auto &changedRows = it.value();
+        std::sort(changedRows.begin(), changedRows.end());
+        int i = 0;
+        while (i < changedRows.count()) {
+            int j = i;
+            while (j + 1 < changedRows.count() && changedRows.at(j + 1) == changedRows.at(j) + 1)
+                j++;
+            auto first = siblings->at(changedRows.at(i));
+            auto last = siblings->at(changedRows.at(j));
+            Q_EMIT dataChanged(first->firstColumnIndex(), last->lastColumnIndex(), roles);
+            i = j + 1;
+        }
+    }
+}
+
 QModelIndex FileItemModel::parent(const QModelIndex &child) const
 {
     FileItem *childItem = static_cast<FileItem*>(child.internalPointer());
@@ -24,8 +24,12 @@
 #define FILEITEMMODEL_H
 
 #include <QAbstractItemModel>
+#include <QPointer>
+#include <QHash>
 #include "peony-core_global.h"
 
+class QTimer;
+
 namespace Peony {
 
 class FileItem;
@@ -134,6 +138,22 @@ public:
 
     const QModelIndex indexFromUri(const QString &uri);
 
+    /*!
+     * \brief scheduleItemUpdate
+     * \param item
+     * \param decorationOnly, only the thumbnail of the item changed.
+     * <br>
+     * Mark the item's data as changed. The changes are coalesced, and model
+     * will emit one dataChanged() for each run of continuous rows per frame.
+     * This avoids the proxy model re-sorting and views relayouting for every
+     * item when a large directory is loading or updating.
+     * The decoration only updates are emitted with Qt::DecorationRole, so that
+     * the proxy model won't re-sort the items.
+     * </br>
+     * \see flushItemUpdates().
+     */
+    void scheduleItemUpdate(FileItem *item, bool decorationOnly = false);
+
     QModelIndex index(int row, int column, const QModelIndex &parent) const override;
     QModelIndex parent(const QModelIndex &child) const override;
 
@@ -252,10 +272,26 @@ public Q_SLOTS:
 
     void setRootIndex(const QModelIndex &index);
 
+protected Q_SLOTS:
+    /*!
+     * \brief flushItemUpdates
+     * <br>
+     * Emit the coalesced dataChanged() of items scheduled updating.
+     * </br>
+     * \see scheduleItemUpdate().
+     */
+    void flushItemUpdates();
+
 private:
+    void emitItemsChanged(const QHash<FileItem*, QPointer<FileItem>> &items, const QVector<int> &roles);
+
     FileItem *m_root_item = nullptr;
     bool m_is_positive = false;
     bool m_can_expand = false;
+
+    QTimer *m_update_timer = nullptr;
+    QHash<FileItem*, QPointer<FileItem>> m_pending_update_items;
+    QHash<FileItem*, QPointer<FileItem>> m_pending_decoration_items;
 };
 
 }
@@ -45,12 +45,59 @@ using namespace Peony;
 QLocale locale = QLocale(QLocale::system().name());
 QCollator comparer = QCollator(locale);
 
+FileItemSortKey::FileItemSortKey(const QString &displayName)
+{
+    display_name = displayName;
+    lower_name = displayName.toLower();
+
+    //same as FileOperationUtils::leftNameIsDuplicatedFileOfRightName()
+    //and leftNameLesserThanRightName(), the last "(n)" is the number.
+    QRegExp regExp("\\(\\d+\\)");
+    duplicate_base_name = displayName;
+    duplicate_base_name.remove(regExp);
+    int pos = 0;
+    QString tmp;
+    while ((pos = regExp.indexIn(displayName, pos)) != -1) {
+        tmp = regExp.cap(0);
+        pos += regExp.matchedLength();
+    }
+    if (!tmp.isEmpty()) {
+        tmp.remove(0, 1);
+        tmp.chop(1);
+        duplicate_num = tmp.toInt();
+    }
+
+    //NOTE: a newly created file might could not get display name soon.
+    if (!displayName.isEmpty()) {
+        auto firstStrUnicode = displayName.at(0).unicode();
+        start_with_chinese = (firstStrUnicode <=0x9FA5 && firstStrUnicode >= 0x4E00);
+    }
+    if (start_with_chinese)
+        collator_key.reset(new QCollatorSortKey(comparer.sortKey(displayName)));
+}
+
 FileItemProxyFilterSortModel::FileItemProxyFilterSortModel(QObject *parent) : QSortFilterProxyModel(parent)
 {
     auto settings = GlobalSettings::getInstance();
     m_show_hidden = settings->isExist("show-hidden")? settings->getValue("show-hidden").toBool(): false;
     m_use_default_name_sort_order = settings->isExist("chinese-first")? settings->getValue("chinese-first").toBool(): false;
     m_folder_first = settings->isExist("folder-first")? settings->getValue("folder-first").toBool(): true;
+
+    //keep the mapping sorted incrementally, inserted and changed rows
+    //are moved to their positions by binary search instead of a full sort.
+    setDynamicSortFilter(true);
+
+    //label names and colors might be changed, the filter ids should follow.
+    auto labelModel = FileLabelModel::getGlobalModel();
+    auto updateLabelFilter = [=](){
+        updateLabelFilterIds();
+        if (m_label_name != "" || m_label_color != Qt::transparent ||
+                m_show_label_names.size() >0 || m_show_label_colors.size() >0 ||
+                m_blur_name != "")
+            invalidateFilter();
+    };
+    connect(labelModel, &FileLabelModel::dataChanged, this, updateLabelFilter);
+    connect(labelModel, &FileLabelModel::modelReset, this, updateLabelFilter);
 }
 
 void FileItemProxyFilterSortModel::setSourceModel(QAbstractItemModel *model)
@@ -104,17 +151,19 @@ bool FileItemProxyFilterSortModel::lessThan(const QModelIndex &left, const QMode
 default_sort:
         switch (sortColumn()) {
         case FileItemModel::FileName: {
-            if (FileOperationUtils::leftNameIsDuplicatedFileOfRightName(leftItem->m_info->displayName(), rightItem->m_info->displayName())) {
-                return FileOperationUtils::leftNameLesserThanRightName(leftItem->info()->displayName(), rightItem->info()->displayName());
+            auto leftKey = sortKey(leftItem);
+            auto rightKey = sortKey(rightItem);
+            if (leftKey->duplicate_base_name == rightKey->duplicate_base_name) {
+                if (leftKey->duplicate_num == rightKey->duplicate_num)
+                    return leftKey->display_name < rightKey->display_name;
+                return leftKey->duplicate_num < rightKey->duplicate_num;
             }
             if (m_use_default_name_sort_order) {
-                QString leftDisplayName = leftItem->m_info->displayName();
-                QString rightDisplayName = rightItem->m_info->displayName();
-                bool leftStartWithChinese = startWithChinese(leftDisplayName);
-                bool rightStartWithChinese = startWithChinese(rightDisplayName);
+                bool leftStartWithChinese = leftKey->start_with_chinese;
+                bool rightStartWithChinese = rightKey->start_with_chinese;
                 //all start with Chinese, use the default compare directly
                 if (leftStartWithChinese && rightStartWithChinese)
-                    return comparer.compare(leftDisplayName, rightDisplayName) < 0;
+                    return leftKey->collator_key->compare(*rightKey->collator_key) < 0;
                 //simplify the logic
                 if (leftStartWithChinese || rightStartWithChinese) {
                     if (sortOrder() == Qt::AscendingOrder) {
@@ -123,7 +172,7 @@ default_sort:
                     return rightStartWithChinese;
                 }
             }
-            return leftItem->m_info->displayName().toLower() < rightItem->m_info->displayName().toLower();
+            return leftKey->lower_name < rightKey->lower_name;
         }
         case FileItemModel::FileSize: {
             return leftItem->m_info->size() < rightItem->m_info->size();
@@ -171,76 +220,30 @@ bool FileItemProxyFilterSortModel::filterAcceptsRow(int sourceRow, const QModelI
         if (! checkFileSizeFilter(item->m_info->size()))
             return false;
 
-        //check the file label filter conditions
-        if (m_label_name != "" || m_label_color != Qt::transparent)
+        //check the file label filter conditions, the names and colors
+        //of conditions were converted to label ids in updateLabelFilterIds().
+        if (m_label_name != "" || m_label_color != Qt::transparent ||
+                m_show_label_names.size() >0 || m_show_label_colors.size() >0 ||
+                m_blur_name != "")
         {
-            QString uri = item->m_info->uri();
-            if (m_label_name != "")
-            {
-                auto names = FileLabelModel::getGlobalModel()->getFileLabels(uri);
-                if (! names.contains(m_label_name))
-                    return false;
-            }
-
-            if (m_label_color != Qt::transparent)
-            {
-                 auto colors = FileLabelModel::getGlobalModel()->getFileColors(uri);
-                 if (! colors.contains(m_label_color))
-                     return false;
-            }
-        }
+            QBitArray labelIds;
+            auto metaInfo = item->m_info->metaInfo();
+            if (metaInfo)
+                labelIds = metaInfo->getMetaInfoIdBits(PEONY_FILE_LABEL_IDS);
 
-        //check mutiple label filter conditions, file has any one of these label is accepted
-        if(m_show_label_names.size() >0 || m_show_label_colors.size() >0)
-        {
-            bool bfind = false;
-            QString uri = item->m_info->uri();
-            if (m_show_label_names.size() >0 )
-            {
-               auto names = FileLabelModel::getGlobalModel()->getFileLabels(uri);
-               for(auto temp : m_show_label_names)
-               {
-                   if(names.contains(temp))
-                   {
-                       bfind = true;
-                       break;
-                   }
-               }
-            }
+            if (m_label_name != "" && ! hasAnyLabelId(labelIds, m_label_name_ids))
+                return false;
 
-            if (! bfind && m_show_label_colors.size() >0)
-            {
-                auto colors = FileLabelModel::getGlobalModel()->getFileColors(uri);
-                for(auto temp : m_show_label_colors)
-                {
-                    if (colors.contains(temp))
-                    {
-                        bfind = true;
-                        break;
-                    }
-                }
-            }
+            if (m_label_color != Qt::transparent && ! hasAnyLabelId(labelIds, m_label_color_ids))
+                return false;
 
-            if (! bfind)
+            //check mutiple label filter conditions, file has any one of these label is accepted
+            if ((m_show_label_names.size() >0 || m_show_label_colors.size() >0) &&
+                    ! hasAnyLabelId(labelIds, m_show_label_ids))
                 return false;
-        }
 
-        //check the blur name, can use as search color labels
-        if (m_blur_name != "")
-        {
-            QString uri = item->m_info->uri();
-            auto names = FileLabelModel::getGlobalModel()->getFileLabels(uri);
-            bool find = false;
-            for(auto temp : names)
-            {
-                if ((m_case_sensitive && temp.indexOf(m_blur_name) >= 0) ||
-                   (! m_case_sensitive && temp.toLower().indexOf(m_blur_name.toLower()) >= 0))
-                {
-                    find = true;
-                    break;
-                }
-            }
-            if (! find)
+            //check the blur name, can use as search color labels
+            if (m_blur_name != "" && ! hasAnyLabelId(labelIds, m_blur_label_ids))
                 return false;
         }
     }
@@ -526,6 +529,7 @@ void FileItemProxyFilterSortModel::setFilterLabelConditions(QString name, QColor
 {
     m_label_name = name;
     m_label_color = color;
+    updateLabelFilterIds();
     invalidateFilter();
 }
 
@@ -542,6 +546,7 @@ void FileItemProxyFilterSortModel::setMutipleLabelConditions(QStringList names,
     {
         m_show_label_colors.append(color);
     }
+    updateLabelFilterIds();
     invalidateFilter();
 }
 
@@ -549,9 +554,55 @@ void FileItemProxyFilterSortModel::setLabelBlurName(QString blurName, bool caseS
 {
     m_blur_name = blurName;
     m_case_sensitive = caseSensitive;
+    updateLabelFilterIds();
     invalidateFilter();
 }
 
+void FileItemProxyFilterSortModel::updateLabelFilterIds()
+{
+    m_label_name_ids.clear();
+    m_label_color_ids.clear();
+    m_show_label_ids.clear();
+    m_blur_label_ids.clear();
+
+    auto labels = FileLabelModel::getGlobalModel()->getAllFileLabelItems();
+    for (auto label : labels) {
+        auto name = label->name();
+        auto color = label->color();
+        if (m_label_name != "" && name == m_label_name)
+            m_label_name_ids<<label->id();
+        if (m_label_color != Qt::transparent && color == m_label_color)
+            m_label_color_ids<<label->id();
+        if (m_show_label_names.contains(name) || m_show_label_colors.contains(color))
+            m_show_label_ids<<label->id();
+        if (m_blur_name != "") {
+            if ((m_case_sensitive && name.indexOf(m_blur_name) >= 0) ||
+               (! m_case_sensitive && name.toLower().indexOf(m_blur_name.toLower()) >= 0))
+                m_blur_label_ids<<label->id();
+        }
+    }
+}
+
+bool FileItemProxyFilterSortModel::hasAnyLabelId(const QBitArray &fileLabelIds, const QVector<int> &ids) const
+{
+    for (auto id : ids) {
+        if (id < fileLabelIds.size() && fileLabelIds.testBit(id))
+            return true;
+    }
+    return false;
+}
+
+const FileItemSortKey *FileItemProxyFilterSortModel::sortKey(FileItem *item) const
+{
+    //the display name is assigned a new string when the info is updated,
+    //so comparing the data pointers is enough for checking the keys.
+    auto displayName = item->m_info->displayName();
+    if (!item->m_sort_key || item->m_sort_key->display_name.constData() != displayName.constData()) {
+        item->m_sort_key.reset(new FileItemSortKey(displayName));
+    }
+    return item->m_sort_key.get();
+}
+
 bool FileItemProxyFilterSortModel::startWithChinese(const QString &displayName) const
 {
     //NOTE: a newly created file might could not get display name soon.
@@ -27,14 +27,53 @@
 #include <QObject>
 #include <QSortFilterProxyModel>
 #include <QColor>
+#include <QCollator>
+#include <QBitArray>
+#include <QVector>
 
 #include "peony-core_global.h"
 
+#include <memory>
+
 namespace Peony {
 
 class FileItem;
 class FileItemModel;
 
+/*!
+ * \brief The FileItemSortKey struct
+ * <br>
+ * The keys for comparing file names. They are computed once from the display
+ * name of an item and cached in the item, so that sorting a directory does not
+ * run regular expressions, lower case conversions or collations for every
+ * comparison.
+ * </br>
+ * \see FileItemProxyFilterSortModel::lessThan().
+ */
+struct FileItemSortKey {
+    explicit FileItemSortKey(const QString &displayName);
+
+    /*!
+     * \brief display_name
+     * The name which keys computed from, the keys are out of date if the
+     * item's display name is not sharing the same data with it.
+     */
+    QString display_name;
+    QString lower_name;
+    /*!
+     * \brief duplicate_base_name
+     * The name removed all "(n)" suffixes, such as "a(1).txt" -> "a.txt".
+     */
+    QString duplicate_base_name;
+    int duplicate_num = 0;
+    bool start_with_chinese = false;
+    /*!
+     * \brief collator_key
+     * Only computed for names starting with Chinese characters.
+     */
+    std::unique_ptr<QCollatorSortKey> collator_key;
+};
+
 class PEONYCORESHARED_EXPORT FileItemProxyFilterSortModel : public QSortFilterProxyModel
 {
     Q_OBJECT
@@ -109,11 +148,22 @@ protected:
     bool lessThan(const QModelIndex &left, const QModelIndex &right) const override;
 
 private:
+    const FileItemSortKey *sortKey(FileItem *item) const;
     bool startWithChinese(const QString &displayName) const;
     bool checkFileTypeFilter(QString type) const;
     bool checkFileModifyTimeFilter(quint64 modifiedTime) const;
     bool checkFileSizeFilter(quint64 size) const;
 
+    /*!
+     * \brief updateLabelFilterIds
+     * <br>
+     * Convert the label names and colors of filter conditions to label ids,
+     * so that filterAcceptsRow() only tests bits of file's label ids.
+     * </br>
+     */
+    void updateLabelFilterIds();
+    bool hasAnyLabelId(const QBitArray &fileLabelIds, const QVector<int> &ids) const;
+
 private:
     bool m_show_hidden;
     bool m_use_default_name_sort_order;
@@ -128,6 +178,11 @@ private:
     QList<int> m_file_type_list, m_modify_time_list, m_file_size_list;
     QStringList m_show_label_names;
     QList<QColor> m_show_label_colors;
+
+    QVector<int> m_label_name_ids;
+    QVector<int> m_label_color_ids;
+    QVector<int> m_show_label_ids;
+    QVector<int> m_blur_label_ids;
 };
 
 }
@@ -28,6 +28,7 @@
 #include "file-utils.h"
 
 #include "file-item-model.h"
+#include "file-item-proxy-filter-sort-model.h"
 
 #include "thumbnail-manager.h"
 
@@ -69,6 +70,7 @@ FileItem::~FileItem()
         delete child;
     }
     m_children->clear();
+    m_children_hash.clear();
 
     delete m_children;
 }
@@ -89,14 +91,13 @@ QVector<FileItem*> *FileItem::findChildrenSync()
     Q_EMIT m_model->findChildrenStarted();
     std::shared_ptr<Peony::FileEnumerator> enumerator = std::make_shared<Peony::FileEnumerator>();
     enumerator->setEnumerateDirectory(m_info->uri());
+    //children infos will be filled in enumerating, no need query them again.
+    enumerator->setQueryFullInfo();
     enumerator->enumerateSync();
     auto infos = enumerator->getChildren(true);
     for (auto info : infos) {
         FileItem *child = new FileItem(info, this, m_model);
-        m_children->append(child);
-        FileInfoJob *job = new FileInfoJob(info);
-        job->setAutoDelete();
-        job->querySync();
+        appendChild(child);
     }
     Q_EMIT m_model->findChildrenFinished();
     return m_children;
@@ -111,9 +112,34 @@ void FileItem::findChildrenAsync()
     m_expanded = true;
     Peony::FileEnumerator *enumerator = new Peony::FileEnumerator;
     enumerator->setEnumerateDirectory(m_info->uri());
+    //children infos will be filled in the enumerating batches,
+    //so we don't need start a FileInfoJob for each child.
+    enumerator->setQueryFullInfo();
     //NOTE: entry a new root might destroyed the current enumeration work.
     //the root item will be delete, so we should cancel the previous enumeration.
     enumerator->connect(this, &FileItem::cancelFindChildren, enumerator, &FileEnumerator::cancel);
+
+    //thumbnails are created once the watcher exists, so that they can be
+    //repainted by its thumbnailUpdated() signal.
+    auto pendingThumbnailUris = std::make_shared<QStringList>();
+
+    //some enumerators, such as the search vfs, do not return the contents,
+    //the children infos are left empty and queried here.
+    auto queryEmptyChildInfo = [=](const std::shared_ptr<FileInfo> &info) {
+        if (!info->isEmptyInfo())
+            return;
+        QString uri = info->uri();
+        auto infoJob = new FileInfoJob(info);
+        infoJob->setAutoDelete();
+        connect(infoJob, &FileInfoJob::queryAsyncFinished, this, [=](){
+            m_model->scheduleItemUpdate(this->getChildFromUri(uri));
+            //otherwise it is still pending and will be created with the queried info.
+            if (m_watcher)
+                ThumbnailManager::getInstance()->createThumbnail(uri, m_watcher);
+        });
+        infoJob->queryAsync();
+    };
+
     enumerator->connect(enumerator, &FileEnumerator::prepared, this, [=](std::shared_ptr<GErrorWrapper> err, const QString &targetUri, bool critical){
         if (critical) {
             QMessageBox::critical(nullptr, tr("Error"), err->message());
@@ -170,38 +196,18 @@ void FileItem::findChildrenAsync()
         enumerator->connect(enumerator, &Peony::FileEnumerator::enumerateFinished, this, [=](bool successed){
             if (successed) {
                 auto infos = enumerator->getChildren(true);
-                m_async_count = infos.count();
-                if (infos.count() == 0) {
-                    Q_EMIT m_model->findChildrenFinished();
-                }
-
                 for (auto info : infos) {
                     FileItem *child = new FileItem(info, this, m_model);
-                    m_children->prepend(child);
-                    FileInfoJob *job = new FileInfoJob(info);
-                    job->setAutoDelete();
-                    /*
-                    FileInfo *shared_info = info.get();
-                    int row = infos.indexOf(info);
-                    //qDebug()<<info->uri()<<row;
-                    job->connect(job, &FileInfoJob::infoUpdated, this, [=](){
-                        qDebug()<<shared_info->iconName()<<row;
-                    });
-                    */
-                    connect(job, &FileInfoJob::infoUpdated, this, [=](){
-                        //the query job is finished and will be deleted soon,
-                        //whatever info was updated, we need decrease the async count.
-                        m_async_count--;
-                        if (m_async_count == 0) {
-                            m_model->insertRows(0, m_children->count(), this->firstColumnIndex());
-                            Q_EMIT this->m_model->findChildrenFinished();
-                            Q_EMIT m_model->updated();
-                            for (auto info : infos) {
-                                ThumbnailManager::getInstance()->createThumbnail(info->uri(), m_watcher);
-                            }
-                        }
-                    });
-                    job->queryAsync();
+                    appendChild(child);
+                }
+                if (!infos.isEmpty()) {
+                    m_model->insertRows(0, m_children->count(), this->firstColumnIndex());
+                }
+                Q_EMIT this->m_model->findChildrenFinished();
+                Q_EMIT m_model->updated();
+                for (auto info : infos) {
+                    queryEmptyChildInfo(info);
+                    *pendingThumbnailUris<<info->uri();
                 }
             } else {
                 Q_EMIT m_model->findChildrenFinished();
@@ -231,7 +237,7 @@ void FileItem::findChildrenAsync()
                     auto infoJob = new FileInfoJob(FileInfo::fromUri(index.data(FileItemModel::UriRole).toString()));
                     infoJob->setAutoDelete();
                     connect(infoJob, &FileInfoJob::queryAsyncFinished, this, [=](){
-                        m_model->dataChanged(m_model->indexFromUri(uri), m_model->indexFromUri(uri));
+                        m_model->scheduleItemUpdate(this->getChildFromUri(uri));
                         auto info = FileInfo::fromUri(uri);
                         if (info->isDesktopFile()) {
                             ThumbnailManager::getInstance()->updateDesktopFileThumbnail(info->uri(), m_watcher);
@@ -241,7 +247,7 @@ void FileItem::findChildrenAsync()
                 }
             });
             connect(m_watcher.get(), &FileWatcher::thumbnailUpdated, this, [=](const QString &uri){
-                m_model->dataChanged(m_model->indexFromUri(uri), m_model->indexFromUri(uri));
+                m_model->scheduleItemUpdate(this->getChildFromUri(uri), true);
             });
             connect(m_watcher.get(), &FileWatcher::directoryDeleted, this, [=](QString uri){
                 //clean all the children, if item index is root index, cd up.
@@ -261,6 +267,11 @@ void FileItem::findChildrenAsync()
             });
             //qDebug()<<"startMonitor";
             m_watcher->startMonitor();
+
+            for (auto uri : *pendingThumbnailUris) {
+                ThumbnailManager::getInstance()->createThumbnail(uri, m_watcher);
+            }
+            pendingThumbnailUris->clear();
         });
     } else {
         enumerator->connect(enumerator, &Peony::FileEnumerator::childrenUpdated, this, [=](const QStringList &uris){
@@ -274,21 +285,27 @@ void FileItem::findChildrenAsync()
                 return ;
             }
 
+            if (uris.isEmpty())
+                return;
+
+            //insert the whole batch at once, so that proxy model and views
+            //only need re-sort and relayout once for a batch.
+            int first = m_children->count();
+            m_model->beginInsertRows(firstColumnIndex(), first, first + uris.count() - 1);
             for (auto uri : uris) {
                 auto info = FileInfo::fromUri(uri);
                 auto item = new FileItem(info, this, m_model);
-                m_model->beginInsertRows(firstColumnIndex(), m_children->count(), m_children->count());
-                m_children->append(item);
-                m_model->endInsertRows();
-                auto infoJob = new FileInfoJob(info);
-                infoJob->setAutoDelete();
-                infoJob->connect(infoJob, &FileInfoJob::infoUpdated, this, [=](){
-                    Q_EMIT m_model->dataChanged(item->firstColumnIndex(), item->lastColumnIndex());
-                    //Q_EMIT m_model->updated();
-                    ThumbnailManager::getInstance()->createThumbnail(info->uri(), m_watcher);
-                });
-                infoJob->queryAsync();
+                appendChild(item);
             }
+            m_model->endInsertRows();
+
+            for (auto uri : uris) {
+                queryEmptyChildInfo(FileInfo::fromUri(uri));
+            }
+
+            //infos have been filled by enumerator, but the watcher which
+            //repaints the thumbnails is created after the enumeration.
+            *pendingThumbnailUris<<uris;
         });
 
         enumerator->connect(enumerator, &Peony::FileEnumerator::enumerateFinished, this, [=](){
@@ -320,7 +337,7 @@ void FileItem::findChildrenAsync()
                     auto infoJob = new FileInfoJob(FileInfo::fromUri(index.data(FileItemModel::UriRole).toString()));
                     infoJob->setAutoDelete();
                     connect(infoJob, &FileInfoJob::queryAsyncFinished, this, [=](){
-                        m_model->dataChanged(m_model->indexFromUri(uri), m_model->indexFromUri(uri));
+                        m_model->scheduleItemUpdate(this->getChildFromUri(uri));
                         auto info = FileInfo::fromUri(uri);
                         if (info->isDesktopFile()) {
                             ThumbnailManager::getInstance()->updateDesktopFileThumbnail(info->uri(), m_watcher);
@@ -330,7 +347,7 @@ void FileItem::findChildrenAsync()
                 }
             });
             connect(m_watcher.get(), &FileWatcher::thumbnailUpdated, this, [=](const QString &uri){
-                m_model->dataChanged(m_model->indexFromUri(uri), m_model->indexFromUri(uri));
+                m_model->scheduleItemUpdate(this->getChildFromUri(uri), true);
             });
             connect(m_watcher.get(), &FileWatcher::directoryDeleted, this, [=](QString uri){
                 //clean all the children, if item index is root index, cd up.
@@ -349,6 +366,11 @@ void FileItem::findChildrenAsync()
             });
             //qDebug()<<"startMonitor";
             m_watcher->startMonitor();
+
+            for (auto uri : *pendingThumbnailUris) {
+                ThumbnailManager::getInstance()->createThumbnail(uri, m_watcher);
+            }
+            pendingThumbnailUris->clear();
         });
     }
 
@@ -373,13 +395,37 @@ bool FileItem::hasChildren()
 
 FileItem *FileItem::getChildFromUri(QString uri)
 {
-    for (auto item : *m_children) {
-        QUrl url = uri;
-        QString decodedUri = url.toDisplayString();
-        if (decodedUri == item->uri())
-            return item;
+    auto child = m_children_hash.value(uri);
+    if (child)
+        return child;
+
+    //children are indexed by their decoded uri.
+    QUrl url = uri;
+    return m_children_hash.value(url.toDisplayString());
+}
+
+void FileItem::appendChild(FileItem *child)
+{
+    child->m_row = m_children->count();
+    m_children->append(child);
+    m_children_hash.insert(child->uri(), child);
+}
+
+void FileItem::removeChild(FileItem *child)
+{
+    int row = child->m_row;
+    if (row < 0 || row >= m_children->count() || m_children->at(row) != child)
+        return;
+
+    m_children->remove(row);
+    if (m_children_hash.value(child->uri()) == child)
+        m_children_hash.remove(child->uri());
+    child->m_row = -1;
+
+    //the children behind the removed one move forward.
+    for (int i = row; i < m_children->count(); i++) {
+        m_children->at(i)->m_row = i;
     }
-    return nullptr;
 }
 
 void FileItem::onChildAdded(const QString &uri)
@@ -388,28 +434,30 @@ void FileItem::onChildAdded(const QString &uri)
     FileItem *child = getChildFromUri(uri);
     if (child) {
         qDebug()<<"has added";
-        //child info maybe changed, so need sync update again
+        //child info maybe changed, so need sync update again.
+        //the dataChanged() makes proxy model move this row only.
         child->updateInfoSync();
-        m_model->updated();
         return;
     }
-    FileItem *newChild = new FileItem(FileInfo::fromUri(uri), this, m_model);
-    m_children->append(newChild);
+    //query the info before inserting, so that the proxy model can
+    //insert the new row into the sorted rows by binary search, the
+    //other rows will not be re-sorted or re-filtered.
+    auto info = FileInfo::fromUri(uri);
+    FileInfoJob job(info);
+    job.querySync();
+    FileItem *newChild = new FileItem(info, this, m_model);
+    appendChild(newChild);
     m_model->insertRow(m_children->count() - 1, this->firstColumnIndex());
-    //use sync update here.
-    newChild->updateInfoSync();
-    m_model->updated();
 }
 
 void FileItem::onChildRemoved(const QString &uri)
 {
     FileItem *child = getChildFromUri(uri);
     if (child) {
-        m_model->removeRow(m_children->indexOf(child), this->firstColumnIndex());
-        m_children->removeOne(child);
+        m_model->removeRow(child->m_row, this->firstColumnIndex());
+        removeChild(child);
     }
     delete child;
-    m_model->updated();
 }
 
 void FileItem::onDeleted(const QString &thisUri)
@@ -424,13 +472,13 @@ void FileItem::onDeleted(const QString &thisUri)
     //doublue clicked twice it will be expanded. a qt's bug?
     if (m_parent) {
         if (m_parent->m_info->uri() == thisUri) {
-            m_model->removeRow(m_parent->m_children->indexOf(this), m_parent->firstColumnIndex());
-            m_parent->m_children->removeOne(this);
+            m_model->removeRow(m_row, m_parent->firstColumnIndex());
+            m_parent->removeChild(this);
         } else {
             //if just clear children, there will be a small problem.
             clearChildren();
-            m_model->removeRow(m_parent->m_children->indexOf(this), m_parent->firstColumnIndex());
-            m_parent->m_children->removeOne(this);
+            m_model->removeRow(m_row, m_parent->firstColumnIndex());
+            m_parent->removeChild(this);
             m_parent->onChildAdded(m_info->uri());
         }
         this->deleteLater();
@@ -475,7 +523,7 @@ void FileItem::updateInfoAsync()
     FileInfoJob *job = new FileInfoJob(m_info);
     job->setAutoDelete();
     job->connect(job, &FileInfoJob::infoUpdated, this, [=](){
-        m_model->dataChanged(this->firstColumnIndex(), this->lastColumnIndex());
+        m_model->scheduleItemUpdate(this);
     });
     job->queryAsync();
 }
@@ -488,6 +536,7 @@ void FileItem::clearChildren()
         delete child;
     }
     m_children->clear();
+    m_children_hash.clear();
     m_expanded = false;
     m_watcher.reset();
     m_watcher = nullptr;
@@ -28,6 +28,7 @@
 
 #include <QObject>
 #include <QVector>
+#include <QHash>
 
 namespace Peony {
 
@@ -36,6 +37,7 @@ class FileInfoManager;
 class FileItemModel;
 class FileWatcher;
 class FileItemProxyFilterSortModel;
+struct FileItemSortKey;
 
 /*!
  * \brief The FileItem class
@@ -115,6 +117,26 @@ protected:
      */
     FileItem *getChildFromUri(QString uri);
 
+    /*!
+     * \brief appendChild
+     * \param child
+     * <br>
+     * Append a child item and index it by its uri and row.
+     * </br>
+     * \note You should always use appendChild() and removeChild() for
+     * changing the children, so that the uri index and rows stay correct.
+     */
+    void appendChild(FileItem *child);
+    /*!
+     * \brief removeChild
+     * \param child
+     * <br>
+     * Remove a child item from children and its index, the rows of the children
+     * behind it will be updated. The child item will not be deleted.
+     * </br>
+     */
+    void removeChild(FileItem *child);
+
     /*!
      * \brief updateInfoSync
      * <br>
@@ -147,14 +169,29 @@ private:
     std::shared_ptr<FileWatcher> m_watcher = nullptr;
 
     /*!
-     * \brief m_async_count
+     * \brief m_row
      * <br>
-     * when enumerate children finished, we start a async job for update children info.
-     * this count is record the current last un-updated children count.
-     * while all job finished, the count will clear, and we can insert the rows to model.
+     * The row of this item in its parent's children. It is kept by parent item,
+     * so that model can get the index of an item in constant time.
      * </br>
+     * \see appendChild(), removeChild().
+     */
+    int m_row = -1;
+
+    /*!
+     * \brief m_children_hash
+     * <br>
+     * Children's uri -> child item, it is used for finding a child in constant time.
+     * </br>
+     * \see getChildFromUri().
+     */
+    QHash<QString, FileItem*> m_children_hash;
+
+    /*!
+     * \brief m_sort_key
+     * Cached name sort keys, see FileItemProxyFilterSortModel::lessThan().
      */
-    int m_async_count = 0;
+    std::unique_ptr<FileItemSortKey> m_sort_key;
 };
 
 }
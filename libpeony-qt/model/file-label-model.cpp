@@ -126,6 +126,7 @@ void FileLabelModel::addLabel(const QString &label, const QColor &color)
     item->m_color = color;
 
     m_labels.append(item);
+    setItemOfId(item->m_id, item);
 
     addId();
 
@@ -155,6 +156,7 @@ void FileLabelModel::removeLabel(int id)
     for (auto item : m_labels) {
         if (item->id() == id) {
             m_labels.removeOne(item);
+            setItemOfId(id, nullptr);
             item->deleteLater();
             break;
         }
@@ -242,12 +244,18 @@ const QList<QColor> FileLabelModel::getFileColors(const QString &uri)
 
 FileLabelItem *FileLabelModel::itemFromId(int id)
 {
-    for (auto item : this->m_labels) {
-        if (id == item->id()) {
-            return item;
-        }
-    }
-    return nullptr;
+    if (id < 0 || id >= m_id_table.size())
+        return nullptr;
+    return m_id_table.at(id);
+}
+
+void FileLabelModel::setItemOfId(int id, FileLabelItem *item)
+{
+    if (id < 0)
+        return;
+    if (id >= m_id_table.size())
+        m_id_table.resize(id + 1);
+    m_id_table[id] = item;
 }
 
 FileLabelItem *FileLabelModel::itemFormIndex(const QModelIndex &index)
@@ -399,6 +407,7 @@ void FileLabelModel::initLabelItems()
             item->setColor(color);
 
             m_labels.append(item);
+            setItemOfId(i, item);
         }
     }
     m_label_settings->endArray();
@@ -27,6 +27,7 @@
 #include <QSettings>
 
 #include <QColor>
+#include <QVector>
 
 #define PEONY_FILE_LABEL_IDS "peony-file-label-ids"
 
@@ -88,6 +89,8 @@ protected:
     void initLabelItems();
     void addId();
 
+    void setItemOfId(int id, FileLabelItem *item);
+
 private:
     explicit FileLabelModel(QObject *parent = nullptr);
     ~FileLabelModel();
@@ -95,6 +98,12 @@ private:
     QSettings *m_label_settings;
 
     QList<FileLabelItem *> m_labels;
+    /*!
+     * \brief m_id_table
+     * Label id -> label item, ids are small and continuous, so
+     * itemFromId() is an array access.
+     */
+    QVector<FileLabelItem *> m_id_table;
 };
 
 class FileLabelItem : public QObject
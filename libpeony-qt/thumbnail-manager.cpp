@@ -32,6 +32,7 @@
 
 #include "generic-thumbnailer.h"
 #include "thumbnail-job.h"
+#include "thumbnail-disk-cache.h"
 
 #include "global-settings.h"
 
@@ -40,7 +41,10 @@
 #include <QUrl>
 
 #include <QThreadPool>
-#include <QSemaphore>
+#include <QThread>
+#include <QVector>
+
+#include <algorithm>
 
 #include <gio/gdesktopappinfo.h>
 
@@ -64,14 +68,22 @@ ThumbnailManager::ThumbnailManager(QObject *parent) : QObject(parent)
     GlobalSettings::getInstance();
 
     m_thumbnail_thread_pool = new QThreadPool(this);
-    m_thumbnail_thread_pool->setMaxThreadCount(1);
+    m_thumbnail_thread_pool->setMaxThreadCount(qMax(1, QThread::idealThreadCount()));
+
+    m_cheap_thread_pool = new QThreadPool(this);
+    m_cheap_thread_pool->setMaxThreadCount(1);
 
-    m_semaphore = new QSemaphore(1);
+    auto settings = GlobalSettings::getInstance();
+    if (settings->isExist(THUMBNAIL_CACHE_SIZE)) {
+        qint64 size = settings->getValue(THUMBNAIL_CACHE_SIZE).toLongLong();
+        if (size > 0)
+            m_cache_size = size;
+    }
 }
 
 ThumbnailManager::~ThumbnailManager()
 {
-    delete m_semaphore;
+
 }
 
 ThumbnailManager *ThumbnailManager::getInstance()
@@ -86,12 +98,105 @@ void ThumbnailManager::syncThumbnailPreferences()
     GlobalSettings::getInstance()->forceSync("do-not-thumbnail");
 }
 
-void ThumbnailManager::insertOrUpdateThumbnail(const QString &uri, const QIcon &icon)
+static qint64 iconCost(const QIcon &icon)
+{
+    //theme icons are loaded lazily and shared by Qt's pixmap cache,
+    //count them as a small pixmap.
+    if (!icon.name().isEmpty())
+        return 64*64*4;
+
+    qint64 cost = 0;
+    for (auto size : icon.availableSizes()) {
+        cost += qint64(size.width())*size.height()*4;
+    }
+    return cost;
+}
+
+void ThumbnailManager::insertOrUpdateThumbnail(const QString &uri, const QIcon &icon, std::shared_ptr<FileWatcher> watcher)
+{
+    auto thumbnail = std::make_shared<CachedThumbnail>();
+    thumbnail->icon = icon;
+    thumbnail->cost = iconCost(icon);
+    //a new thumbnail is going to be painted, do not evict it at once.
+    thumbnail->last_painted.store(++m_paint_tick);
+    thumbnail->watcher = watcher;
+
+    QList<QPair<QString, std::weak_ptr<FileWatcher>>> evicted;
+    m_hash_lock.lockForWrite();
+    auto old = m_hash.value(uri);
+    if (old)
+        m_cache_cost -= old->cost;
+    m_hash.insert(uri, thumbnail);
+    m_cache_cost += thumbnail->cost;
+    evictLocked(evicted);
+    m_hash_lock.unlock();
+
+    deferEvictedUris(evicted);
+}
+
+void ThumbnailManager::evictLocked(QList<QPair<QString, std::weak_ptr<FileWatcher>>> &evicted)
 {
-    m_semaphore->acquire();
-    m_hash.remove(uri);
-    m_hash.insert(uri, icon);
-    m_semaphore->release();
+    if (m_cache_cost <= m_cache_size)
+        return;
+
+    //evict in batch, so that we won't sort the whole cache for every insertion.
+    QVector<QPair<quint64, QString>> entries;
+    entries.reserve(m_hash.count());
+    for (auto it = m_hash.constBegin(); it != m_hash.constEnd(); it++) {
+        entries<<qMakePair(it.value()->last_painted.load(), it.key());
+    }
+    std::sort(entries.begin(), entries.end());
+
+    qint64 target = m_cache_size/10*9;
+    for (auto entry : entries) {
+        if (m_cache_cost <= target)
+            break;
+        auto thumbnail = m_hash.take(entry.second);
+        m_cache_cost -= thumbnail->cost;
+        evicted<<qMakePair(entry.second, thumbnail->watcher);
+        m_eviction_count++;
+    }
+}
+
+void ThumbnailManager::deferEvictedUris(const QList<QPair<QString, std::weak_ptr<FileWatcher>>> &evicted)
+{
+    if (evicted.isEmpty())
+        return;
+
+    //NOTE: m_hash_lock must not be locked here, createThumbnail() takes
+    //the hash lock with the jobs mutex locked.
+    QMutexLocker locker(&m_jobs_mutex);
+    for (auto pair : evicted) {
+        if (!pair.second.expired() && !m_pending_jobs.contains(pair.first))
+            m_deferred_uris.insert(pair.first, pair.second);
+    }
+}
+
+void ThumbnailManager::setCacheSize(qint64 size)
+{
+    if (size <= 0)
+        size = PEONY_THUMBNAIL_DEFAULT_CACHE_SIZE;
+    GlobalSettings::getInstance()->setValue(THUMBNAIL_CACHE_SIZE, size);
+
+    QList<QPair<QString, std::weak_ptr<FileWatcher>>> evicted;
+    m_hash_lock.lockForWrite();
+    m_cache_size = size;
+    evictLocked(evicted);
+    m_hash_lock.unlock();
+
+    deferEvictedUris(evicted);
+}
+
+qint64 ThumbnailManager::cacheSize()
+{
+    QReadLocker locker(&m_hash_lock);
+    return m_cache_size;
+}
+
+qint64 ThumbnailManager::cacheCost()
+{
+    QReadLocker locker(&m_hash_lock);
+    return m_cache_cost;
 }
 
 void ThumbnailManager::setForbidThumbnailInView(bool forbid)
@@ -119,18 +224,37 @@ void ThumbnailManager::createThumbnailInternal(const QString &uri, std::shared_p
                 url = FileUtils::getTargetUri(info->uri());
                 qDebug()<<url;
             }
-            QIcon thumbnail = GenericThumbnailer::generateThumbnail(url.path(), true);
+            QIcon thumbnail;
+            if (url.path().endsWith(".svg")) {
+                thumbnail = GenericThumbnailer::generateThumbnail(url.path(), true);
+            } else {
+                //try the persistent cache first, decoding the image is expensive.
+                auto mtime = info->modifiedTime();
+                QString cacheUri = url.toEncoded();
+                QImage image = ThumbnailDiskCache::loadThumbnail(cacheUri, mtime);
+                if (image.isNull()) {
+                    if (ThumbnailDiskCache::hasFailed(cacheUri, mtime))
+                        return;
+                    image = GenericThumbnailer::scaledImage(url.path());
+                    if (image.isNull()) {
+                        ThumbnailDiskCache::markFailed(cacheUri, mtime);
+                        return;
+                    }
+                    ThumbnailDiskCache::saveThumbnail(cacheUri, mtime, image);
+                }
+                thumbnail = GenericThumbnailer::generateThumbnail(image, true);
+            }
             //thumbnail.addFile(url.path());
             if (!thumbnail.isNull()) {
                 //add lock
                 //m_mutex.lock();
                 //m_hash.remove(uri);
                 //m_hash.insert(uri, thumbnail);
-                insertOrUpdateThumbnail(uri, thumbnail);
+                insertOrUpdateThumbnail(uri, thumbnail, watcher);
                 auto info = FileInfo::fromUri(uri);
                 //Q_EMIT info->updated();
                 if (watcher) {
-                    watcher->fileChanged(uri);
+                    watcher->thumbnailUpdated(uri);
                 }
                 //info->setThumbnail(thumbnail);
                 //m_mutex.unlock();
@@ -142,9 +266,22 @@ void ThumbnailManager::createThumbnailInternal(const QString &uri, std::shared_p
                 url = FileUtils::getTargetUri(info->uri());
                 qDebug()<<url;
             }
-            PdfThumbnail pdfThumbnail(info->uri());
+            //rendering a pdf page is expensive, try the persistent cache first.
+            auto mtime = info->modifiedTime();
+            QString cacheUri = url.toEncoded();
+            QPixmap pix = QPixmap::fromImage(ThumbnailDiskCache::loadThumbnail(cacheUri, mtime));
+            if (pix.isNull()) {
+                if (ThumbnailDiskCache::hasFailed(cacheUri, mtime))
+                    return;
+                PdfThumbnail pdfThumbnail(info->uri());
+                pix = pdfThumbnail.generateThumbnail();
+                if (pix.isNull()) {
+                    ThumbnailDiskCache::markFailed(cacheUri, mtime);
+                    return;
+                }
+                ThumbnailDiskCache::saveThumbnail(cacheUri, mtime, pix.toImage());
+            }
             QIcon thumbnail;
-            QPixmap pix = pdfThumbnail.generateThumbnail();
             thumbnail = GenericThumbnailer::generateThumbnail(pix, true);
             //thumbnail.addFile(url.path());
             if (!thumbnail.isNull()) {
@@ -152,11 +289,11 @@ void ThumbnailManager::createThumbnailInternal(const QString &uri, std::shared_p
                 //m_mutex.lock();
                 //m_hash.remove(uri);
                 //m_hash.insert(uri, thumbnail);
-                insertOrUpdateThumbnail(uri, thumbnail);
+                insertOrUpdateThumbnail(uri, thumbnail, watcher);
                 auto info = FileInfo::fromUri(uri);
                 //Q_EMIT info->updated();
                 if (watcher) {
-                    watcher->fileChanged(uri);
+                    watcher->thumbnailUpdated(uri);
                 }
                 //info->setThumbnail(thumbnail);
                 //m_mutex.unlock();
@@ -195,11 +332,11 @@ void ThumbnailManager::createThumbnailInternal(const QString &uri, std::shared_p
                 //m_mutex.lock();
                 //m_hash.remove(uri);
                 //m_hash.insert(uri, thumbnail);
-                insertOrUpdateThumbnail(uri, thumbnail);
+                insertOrUpdateThumbnail(uri, thumbnail, watcher);
                 auto info = FileInfo::fromUri(uri);
                 //Q_EMIT info->updated();
                 if (watcher) {
-                    watcher->fileChanged(uri);
+                    watcher->thumbnailUpdated(uri);
                 }
                 //info->setThumbnail(thumbnail);
                 //m_mutex.unlock();
@@ -210,8 +347,133 @@ void ThumbnailManager::createThumbnailInternal(const QString &uri, std::shared_p
 
 void ThumbnailManager::createThumbnail(const QString &uri, std::shared_ptr<FileWatcher> watcher, bool force)
 {
+    auto threadPool = threadPoolForUri(uri);
+    m_jobs_mutex.lock();
+    if (m_pending_jobs.contains(uri)) {
+        //the job is still waiting in queue.
+        m_jobs_mutex.unlock();
+        return;
+    }
+    m_deferred_uris.remove(uri);
+    bool prioritized = isVisibleInViews(uri);
     auto thumbnailJob = new ThumbnailJob(uri, watcher, this);
-    m_thumbnail_thread_pool->start(thumbnailJob);
+    thumbnailJob->m_thread_pool = threadPool;
+    m_pending_jobs.insert(uri, thumbnailJob);
+    startJob(thumbnailJob, prioritized);
+    m_jobs_mutex.unlock();
+}
+
+void ThumbnailManager::startJob(ThumbnailJob *job, bool prioritized)
+{
+    //NOTE: m_jobs_mutex must be locked here.
+    if (prioritized) {
+        m_prioritized_uris.insert(job->uri());
+    } else {
+        m_prioritized_uris.remove(job->uri());
+    }
+    job->m_thread_pool->start(job, prioritized? 1: 0);
+}
+
+QThreadPool *ThumbnailManager::threadPoolForUri(const QString &uri)
+{
+    //do not query an uncached info here, it might block on a remote mount.
+    auto info = FileInfoManager::getInstance()->findFileInfoByUri(uri);
+    if (!info || info->mimeType().isEmpty())
+        return m_thumbnail_thread_pool;
+    if (info->mimeType().startsWith("image/") || info->mimeType().contains("pdf"))
+        return m_thumbnail_thread_pool;
+    return m_cheap_thread_pool;
+}
+
+bool ThumbnailManager::isVisibleInViews(const QString &uri)
+{
+    //NOTE: m_jobs_mutex must be locked here.
+    for (auto uris : m_visible_uris) {
+        if (uris.contains(uri))
+            return true;
+    }
+    return false;
+}
+
+void ThumbnailManager::takePendingJob(ThumbnailJob *job)
+{
+    QMutexLocker locker(&m_jobs_mutex);
+    if (m_pending_jobs.value(job->uri()) == job) {
+        m_pending_jobs.remove(job->uri());
+        m_prioritized_uris.remove(job->uri());
+    }
+}
+
+void ThumbnailManager::prioritizeVisibleUris(QObject *view, const QStringList &uris)
+{
+#if QT_VERSION >= QT_VERSION_CHECK(5, 9, 0)
+    QSet<QString> visibleUris;
+    for (auto uri : uris) {
+        visibleUris.insert(uri);
+    }
+
+    QList<ThumbnailJob*> droppedJobs;
+    QList<QPair<QString, std::shared_ptr<FileWatcher>>> requeuedUris;
+
+    m_jobs_mutex.lock();
+    if (!m_visible_uris.contains(view)) {
+        connect(view, &QObject::destroyed, this, [=](){
+            QMutexLocker locker(&m_jobs_mutex);
+            m_visible_uris.remove(view);
+        });
+    }
+    auto lastVisibleUris = m_visible_uris.value(view);
+    m_visible_uris.insert(view, visibleUris);
+
+    for (auto uri : visibleUris) {
+        auto job = m_pending_jobs.value(uri);
+        if (job) {
+            //move the waiting job to the front of queue.
+            if (!m_prioritized_uris.contains(uri) && job->m_thread_pool->tryTake(job)) {
+                startJob(job, true);
+            }
+        } else if (m_deferred_uris.contains(uri)) {
+            auto watcher = m_deferred_uris.take(uri).lock();
+            if (watcher)
+                requeuedUris<<qMakePair(uri, watcher);
+        }
+    }
+
+    for (auto uri : lastVisibleUris) {
+        if (visibleUris.contains(uri) || isVisibleInViews(uri))
+            continue;
+        //scrolled away, drop its pending work.
+        auto job = m_pending_jobs.value(uri);
+        if (job && job->m_thread_pool->tryTake(job)) {
+            m_pending_jobs.remove(uri);
+            m_prioritized_uris.remove(uri);
+            m_deferred_uris.insert(uri, job->watcher());
+            droppedJobs<<job;
+        }
+    }
+
+    //the directories of these uris might have been closed.
+    for (auto it = m_deferred_uris.begin(); it != m_deferred_uris.end();) {
+        if (it.value().expired()) {
+            it = m_deferred_uris.erase(it);
+        } else {
+            it++;
+        }
+    }
+    m_jobs_mutex.unlock();
+
+    //job's destructor will lock the jobs mutex.
+    for (auto job : droppedJobs) {
+        delete job;
+    }
+
+    for (auto pair : requeuedUris) {
+        createThumbnail(pair.first, pair.second);
+    }
+#else
+    Q_UNUSED(view);
+    Q_UNUSED(uris);
+#endif
 }
 
 void ThumbnailManager::updateDesktopFileThumbnail(const QString &uri, std::shared_ptr<FileWatcher> watcher)
@@ -249,7 +511,7 @@ void ThumbnailManager::updateDesktopFileThumbnail(const QString &uri, std::share
                 //m_mutex.lock();
                 //m_hash.remove(uri);
                 //m_hash.insert(uri, thumbnail);
-                insertOrUpdateThumbnail(uri, thumbnail);
+                insertOrUpdateThumbnail(uri, thumbnail, watcher);
                 auto info = FileInfo::fromUri(uri);
                 //Q_EMIT info->updated();
                 if (watcher) {
@@ -269,19 +531,27 @@ void ThumbnailManager::updateDesktopFileThumbnail(const QString &uri, std::share
 
 void ThumbnailManager::releaseThumbnail(const QString &uri)
 {
-    //m_mutex.lock();
-    m_semaphore->acquire();
-    m_hash.remove(uri);
-    m_semaphore->release();
-    //m_mutex.unlock();
+    QWriteLocker locker(&m_hash_lock);
+    auto thumbnail = m_hash.take(uri);
+    if (thumbnail)
+        m_cache_cost -= thumbnail->cost;
+}
+
+bool ThumbnailManager::hasThumbnail(const QString &uri)
+{
+    QReadLocker locker(&m_hash_lock);
+    return m_hash.contains(uri);
 }
 
 const QIcon ThumbnailManager::tryGetThumbnail(const QString &uri)
 {
-    //m_mutex.lock();
-    m_semaphore->acquire();
-    auto icon = m_hash.value(uri);
-    m_semaphore->release();
-    //m_mutex.unlock();
-    return icon;
+    QReadLocker locker(&m_hash_lock);
+    auto thumbnail = m_hash.value(uri);
+    if (!thumbnail) {
+        m_miss_count++;
+        return QIcon();
+    }
+    m_hit_count++;
+    thumbnail->last_painted.store(++m_paint_tick);
+    return thumbnail->icon;
 }
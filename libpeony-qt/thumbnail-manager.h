@@ -28,16 +28,32 @@
 #include "file-info.h"
 
 #include <QHash>
+#include <QSet>
 #include <QIcon>
 #include <QMutex>
+#include <QReadWriteLock>
+#include <QAtomicInteger>
+
+#ifndef PEONY_THUMBNAIL_DEFAULT_CACHE_SIZE
+#define PEONY_THUMBNAIL_DEFAULT_CACHE_SIZE 128*1024*1024
+#endif
 
 class QThreadPool;
-class QSemaphore;
 
 namespace Peony {
 
 class FileWatcher;
-
+class ThumbnailJob;
+
+/*!
+ * \brief The ThumbnailManager class
+ * <br>
+ * ThumbnailManager generates thumbnails in thread pools and keeps them in
+ * memory. The memory cache has a budget in bytes of pixmaps (see setCacheSize()).
+ * When the budget is exceeded, the least recently painted thumbnails are evicted,
+ * they will be generated again once their items become visible in views.
+ * </br>
+ */
 class PEONYCORESHARED_EXPORT ThumbnailManager : public QObject
 {
     friend class ThumbnailJob;
@@ -47,31 +63,154 @@ public:
 
     void setForbidThumbnailInView(bool forbid);
 
-    bool hasThumbnail(const QString &uri) {return !m_hash.values(uri).isEmpty();}
+    bool hasThumbnail(const QString &uri);
 
     void createThumbnail(const QString &uri, std::shared_ptr<FileWatcher> watcher = nullptr, bool force = false);
     void releaseThumbnail(const QString &uri);
     void updateDesktopFileThumbnail(const QString &uri, std::shared_ptr<FileWatcher> watcher = nullptr);
     const QIcon tryGetThumbnail(const QString &uri);
 
+    /*!
+     * \brief prioritizeVisibleUris
+     * \param view, the view which is showing these uris.
+     * \param uris, the uris in view's viewport.
+     * <br>
+     * Views should call this method when their visible items changed.
+     * The pending thumbnail jobs of visible uris will be moved to the front of
+     * the queue. The pending jobs of uris which are scrolled away will be dropped,
+     * and they will be queued again once they become visible.
+     * </br>
+     * \note Thumbnail jobs are queued in enumeration order by default.
+     */
+    void prioritizeVisibleUris(QObject *view, const QStringList &uris);
+
+    /*!
+     * \brief setCacheSize
+     * \param size, the budget of thumbnails in memory, in bytes.
+     * <br>
+     * If size is not more than 0, PEONY_THUMBNAIL_DEFAULT_CACHE_SIZE will be used.
+     * The budget is also saved in global settings, see THUMBNAIL_CACHE_SIZE.
+     * </br>
+     */
+    void setCacheSize(qint64 size);
+    qint64 cacheSize();
+    /*!
+     * \brief cacheCost
+     * \return the bytes of thumbnails currently in memory.
+     */
+    qint64 cacheCost();
+
+    /*!
+     * \brief hitCount
+     * \return the count of tryGetThumbnail() calls which found a thumbnail.
+     */
+    quint64 hitCount() {return m_hit_count.load();}
+    quint64 missCount() {return m_miss_count.load();}
+    quint64 evictionCount() {return m_eviction_count.load();}
+
 Q_SIGNALS:
 
 public Q_SLOTS:
     void syncThumbnailPreferences();
 
 protected:
-    void insertOrUpdateThumbnail(const QString &uri, const QIcon &icon);
+    void insertOrUpdateThumbnail(const QString &uri, const QIcon &icon, std::shared_ptr<FileWatcher> watcher = nullptr);
+
+    /*!
+     * \brief takePendingJob
+     * \param job
+     * <br>
+     * Called when a job started running or destroyed, the job
+     * could not be re-prioritized or dropped any more.
+     * </br>
+     */
+    void takePendingJob(ThumbnailJob *job);
+    void startJob(ThumbnailJob *job, bool prioritized);
+    /*!
+     * \brief threadPoolForUri
+     * \param uri
+     * \return the pool for expensive work (images, pdf) or the one for cheap work.
+     * <br>
+     * Only the cached info is used, the uris of unknown types go to the expensive pool.
+     * It does no i/o, but it should still be called without m_jobs_mutex locked.
+     * </br>
+     */
+    QThreadPool *threadPoolForUri(const QString &uri);
+    bool isVisibleInViews(const QString &uri);
 
 private:
     explicit ThumbnailManager(QObject *parent = nullptr);
     ~ThumbnailManager();
     void createThumbnailInternal(const QString &uri, std::shared_ptr<FileWatcher> watcher = nullptr, bool force = false);
 
-    QHash<QString, QIcon> m_hash;
-    //QMutex m_mutex;
-
+    struct CachedThumbnail {
+        QIcon icon;
+        qint64 cost = 0;
+        /*!
+         * \brief last_painted
+         * The paint tick of last tryGetThumbnail(), it is updated
+         * atomically so that painting only needs the read lock.
+         */
+        QAtomicInteger<quint64> last_painted;
+        std::weak_ptr<FileWatcher> watcher;
+    };
+
+    /*!
+     * \brief evictLocked
+     * \param evicted, the evicted uris and their watchers.
+     * <br>
+     * Evict the least recently painted thumbnails until the cost is
+     * lower than 90% of the budget. m_hash_lock must be locked for writing.
+     * </br>
+     */
+    void evictLocked(QList<QPair<QString, std::weak_ptr<FileWatcher>>> &evicted);
+    /*!
+     * \brief deferEvictedUris
+     * \param evicted
+     * Remember the evicted uris, so they can be generated again once visible.
+     */
+    void deferEvictedUris(const QList<QPair<QString, std::weak_ptr<FileWatcher>>> &evicted);
+
+    QHash<QString, std::shared_ptr<CachedThumbnail>> m_hash;
+    /*!
+     * \brief m_hash_lock
+     * tryGetThumbnail() is called in painting, it only takes the read lock
+     * so that it won't be blocked by other readers.
+     */
+    QReadWriteLock m_hash_lock;
+    qint64 m_cache_cost = 0;
+    qint64 m_cache_size = PEONY_THUMBNAIL_DEFAULT_CACHE_SIZE;
+
+    QAtomicInteger<quint64> m_paint_tick;
+    QAtomicInteger<quint64> m_hit_count;
+    QAtomicInteger<quint64> m_miss_count;
+    QAtomicInteger<quint64> m_eviction_count;
+
+    /*!
+     * \brief m_thumbnail_thread_pool
+     * Decodes images and renders pdf pages, it is sized to the cpu count.
+     */
     QThreadPool *m_thumbnail_thread_pool;
-    QSemaphore *m_semaphore;
+    /*!
+     * \brief m_cheap_thread_pool
+     * Handles desktop files and other types which need no decoding. It keeps
+     * a single thread, icon theme lookup is not safe to run concurrently.
+     */
+    QThreadPool *m_cheap_thread_pool;
+
+    /*!
+     * \brief m_jobs_mutex
+     * protects the pending jobs, prioritized and deferred uris.
+     */
+    QMutex m_jobs_mutex;
+    QHash<QString, ThumbnailJob*> m_pending_jobs;
+    QSet<QString> m_prioritized_uris;
+    /*!
+     * \brief m_deferred_uris
+     * The uris whose pending jobs were dropped because they are scrolled away.
+     */
+    QHash<QString, std::weak_ptr<FileWatcher>> m_deferred_uris;
+    QHash<QObject*, QSet<QString>> m_visible_uris;
 };
 
 }
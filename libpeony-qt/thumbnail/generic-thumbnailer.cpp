@@ -28,62 +28,134 @@
 #include <QFileInfo>
 
 #include <QPainter>
+#include <QImage>
+#include <QImageReader>
+
+#include <string.h>
+
+#define PEONY_THUMBNAIL_WIDTH 128
+#define PEONY_EXIF_SEARCH_SIZE 128*1024
 
 extern void qt_blurImage(QImage &blurImage, qreal radius, bool quality, int transposed);
 
-QIcon GenericThumbnailer::generateThumbnail(const QUrl &url, bool shadow, const QSize &size)
+static quint32 readExifValue(const uchar *data, int size, bool bigEndian)
 {
-    QIcon icon;
-    QFile file(url.path());
-    if (!file.exists())
-        return icon;
-
-    //skip svg
-    if (url.path().endsWith(".svg")) {
-        if (file.size() < 1024*1024*8)
-            icon.addFile(url.path());
-        return icon;
+    quint32 value = 0;
+    for (int i = 0; i < size; i++) {
+        int shift = bigEndian? (size - 1 - i)*8: i*8;
+        value |= quint32(data[i]) << shift;
     }
+    return value;
+}
 
-    QImage img(url.path());
-
-    if (img.rect().size().width() > 128) {
-        //scale large size image.
-        if (size.isValid()) {
-            img = img.scaled(size, Qt::IgnoreAspectRatio, Qt::SmoothTransformation);
-        } else {
-            img = img.scaledToWidth(128, Qt::SmoothTransformation);
+/*!
+ * \brief readExifThumbnail
+ * \param path, path of a jpeg file.
+ * \param imageSize, size of the full image.
+ * \return the thumbnail embedded in the exif data (IFD1), or a null image
+ * if there is no usable one.
+ */
+static QImage readExifThumbnail(const QString &path, const QSize &imageSize)
+{
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly))
+        return QImage();
+
+    //the exif segment must be the first segment after SOI (and an optional JFIF segment).
+    QByteArray head = file.read(PEONY_EXIF_SEARCH_SIZE);
+    auto data = reinterpret_cast<const uchar *>(head.constData());
+    int length = head.length();
+    if (length < 4 || data[0] != 0xff || data[1] != 0xd8)
+        return QImage();
+
+    int pos = 2;
+    int tiff = -1;
+    int tiffLength = 0;
+    while (pos + 4 <= length && data[pos] == 0xff) {
+        int marker = data[pos + 1];
+        int segmentLength = readExifValue(data + pos + 2, 2, true);
+        if (marker == 0xe1 && pos + 10 <= length && memcmp(data + pos + 4, "Exif\0\0", 6) == 0) {
+            tiff = pos + 10;
+            tiffLength = qMin(segmentLength - 8, length - tiff);
+            break;
         }
+        if (marker == 0xda)
+            break;
+        pos += 2 + segmentLength;
+    }
+    if (tiff < 0 || tiffLength < 8)
+        return QImage();
+
+    const uchar *tiffData = data + tiff;
+    bool bigEndian;
+    if (memcmp(tiffData, "MM", 2) == 0) {
+        bigEndian = true;
+    } else if (memcmp(tiffData, "II", 2) == 0) {
+        bigEndian = false;
+    } else {
+        return QImage();
     }
 
-    if (img.hasAlphaChannel()) {
-        //skip shadow
-        icon.addPixmap(QPixmap::fromImage(img));
-        return icon;
+    //skip IFD0, the offset of IFD1 follows its entries.
+    //offsets are read from the file, use 64 bit integers so that they never overflow.
+    qint64 ifd0 = readExifValue(tiffData + 4, 4, bigEndian);
+    if (ifd0 + 2 > tiffLength)
+        return QImage();
+    qint64 ifd0Count = readExifValue(tiffData + ifd0, 2, bigEndian);
+    qint64 nextIfdPos = ifd0 + 2 + ifd0Count*12;
+    if (nextIfdPos + 4 > tiffLength)
+        return QImage();
+    qint64 ifd1 = readExifValue(tiffData + nextIfdPos, 4, bigEndian);
+    if (ifd1 == 0 || ifd1 + 2 > tiffLength)
+        return QImage();
+
+    qint64 thumbnailOffset = 0;
+    qint64 thumbnailLength = 0;
+    qint64 ifd1Count = readExifValue(tiffData + ifd1, 2, bigEndian);
+    for (qint64 i = 0; i < ifd1Count; i++) {
+        qint64 entry = ifd1 + 2 + i*12;
+        if (entry + 12 > tiffLength)
+            break;
+        quint32 tag = readExifValue(tiffData + entry, 2, bigEndian);
+        quint32 value = readExifValue(tiffData + entry + 8, 4, bigEndian);
+        if (tag == 0x0201) {
+            thumbnailOffset = value;
+        } else if (tag == 0x0202) {
+            thumbnailLength = value;
+        }
     }
+    if (thumbnailOffset == 0 || thumbnailLength == 0 || thumbnailOffset + thumbnailLength > tiffLength)
+        return QImage();
 
-    if (shadow) {
-        QPixmap pixmap = QPixmap::fromImage(img);
-        pixmap = pixmap.scaled(img.rect().adjusted(4, 4, -4, -4).size(), Qt::IgnoreAspectRatio, Qt::SmoothTransformation);
+    QImage thumbnail = QImage::fromData(tiffData + thumbnailOffset, int(thumbnailLength), "JPEG");
+    if (thumbnail.isNull())
+        return thumbnail;
 
-        QImage newImg(img.size(), QImage::Format_ARGB32);
-        newImg.fill(Qt::transparent);
-        QPainter p(&newImg);
+    //some cameras pad the thumbnail to 4:3 with black bars, do not use it
+    //if its aspect ratio does not match the image.
+    qreal imageRatio = qreal(imageSize.width())/imageSize.height();
+    qreal thumbnailRatio = qreal(thumbnail.width())/thumbnail.height();
+    if (qAbs(imageRatio - thumbnailRatio) > 0.02*imageRatio)
+        return QImage();
 
-        p.setPen(Qt::transparent);
-        p.setBrush(Qt::gray);
-        p.drawRect(newImg.rect().adjusted(4, 4, -4, -4));
+    return thumbnail;
+}
 
-        qt_blurImage(newImg, 4, false, false);
-        p.drawPixmap(newImg.rect().adjusted(4, 4, -4, -4), pixmap);
+QIcon GenericThumbnailer::generateThumbnail(const QUrl &url, bool shadow, const QSize &size)
+{
+    QIcon icon;
+    QFile file(url.path());
+    if (!file.exists())
+        return icon;
 
-        p.end();
-        icon.addPixmap(QPixmap::fromImage(newImg));
-    } else {
-        icon.addPixmap(QPixmap::fromImage(img));
+    //skip svg
+    if (url.path().endsWith(".svg")) {
+        if (file.size() < 1024*1024*8)
+            icon.addFile(url.path());
+        return icon;
     }
 
-    return icon;
+    return generateThumbnail(scaledImage(url.path(), size), shadow);
 }
 
 QIcon GenericThumbnailer::generateThumbnail(const QString &path, bool shadow, const QSize &size)
@@ -100,16 +172,57 @@ QIcon GenericThumbnailer::generateThumbnail(const QString &path, bool shadow, co
         return icon;
     }
 
-    QImage img(path);
-    if (img.rect().size().width() > 128) {
-        //scale large size image.
-        if (size.isValid()) {
-            img = img.scaled(size, Qt::IgnoreAspectRatio, Qt::SmoothTransformation);
-        } else {
-            img = img.scaledToWidth(128, Qt::SmoothTransformation);
+    return generateThumbnail(scaledImage(path, size), shadow);
+}
+
+QImage GenericThumbnailer::scaledImage(const QString &path, const QSize &size)
+{
+    QImageReader reader(path);
+    QSize imageSize = reader.size();
+    if (!imageSize.isValid()) {
+        //the format can not tell its size before decoding.
+        QImage img = reader.read();
+        if (img.width() > PEONY_THUMBNAIL_WIDTH) {
+            if (size.isValid()) {
+                img = img.scaled(size, Qt::IgnoreAspectRatio, Qt::SmoothTransformation);
+            } else {
+                img = img.scaledToWidth(PEONY_THUMBNAIL_WIDTH, Qt::SmoothTransformation);
+            }
         }
+        return img;
     }
 
+    if (imageSize.width() <= PEONY_THUMBNAIL_WIDTH) {
+        return reader.read();
+    }
+
+    QSize targetSize = size;
+    if (!targetSize.isValid()) {
+        targetSize = QSize(PEONY_THUMBNAIL_WIDTH, qMax(1, imageSize.height()*PEONY_THUMBNAIL_WIDTH/imageSize.width()));
+    }
+
+    //a camera photo usually carries a small jpeg in its exif data,
+    //decode it instead of the whole picture if it is large enough.
+    if (reader.format() == "jpeg") {
+        QImage exifThumbnail = readExifThumbnail(path, imageSize);
+        if (!exifThumbnail.isNull() && exifThumbnail.width() >= targetSize.width()) {
+            return exifThumbnail.scaled(targetSize, Qt::IgnoreAspectRatio, Qt::SmoothTransformation);
+        }
+    }
+
+    //let the decoder scale the image while decoding, for jpeg this is
+    //done by dct scaling, so the full size image is never allocated.
+    reader.setScaledSize(targetSize);
+    return reader.read();
+}
+
+QIcon GenericThumbnailer::generateThumbnail(const QImage &image, bool shadow)
+{
+    QIcon icon;
+    if (image.isNull())
+        return icon;
+
+    QImage img = image;
     if (img.hasAlphaChannel()) {
         //skip shadow
         icon.addPixmap(QPixmap::fromImage(img));
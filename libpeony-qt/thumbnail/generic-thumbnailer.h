@@ -33,6 +33,20 @@ public:
     static QIcon generateThumbnail(const QUrl &url, bool shadow = false, const QSize &size = QSize());
     static QIcon generateThumbnail(const QString &path, bool shadow = false, const QSize &size = QSize());
     static QIcon generateThumbnail(const QPixmap &pixmap, bool shadow = true, const QSize &size = QSize());
+
+    /*!
+     * \brief scaledImage
+     * \param path
+     * \param size
+     * \return the image scaled to thumbnail size, without shadow.
+     */
+    static QImage scaledImage(const QString &path, const QSize &size = QSize());
+    /*!
+     * \brief generateThumbnail
+     * \param image, a scaled image, such as the return value of scaledImage().
+     * \param shadow
+     */
+    static QIcon generateThumbnail(const QImage &image, bool shadow = false);
 private:
     explicit GenericThumbnailer(QObject *parent = nullptr);
 };
@@ -0,0 +1,175 @@
+/*
+ * Peony-Qt's Library
+ *
+ * Copyright (C) 2020, Tianjin KYLIN Information Technology Co., Ltd.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this library.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * Authors: Yue Lan <lanyue@kylinos.cn>
+ *
+ */
+
+#include "thumbnail-disk-cache.h"
+
+#include <QStandardPaths>
+#include <QCryptographicHash>
+#include <QImageReader>
+#include <QImageWriter>
+#include <QSaveFile>
+#include <QFile>
+#include <QDir>
+
+#include <gio/gio.h>
+
+#define THUMBNAIL_NORMAL_SIZE 128
+#define THUMBNAIL_LARGE_SIZE 256
+
+using namespace Peony;
+
+QImage ThumbnailDiskCache::loadThumbnail(const QString &uri, quint64 mtime, const QSize &size)
+{
+    if (mtime == 0)
+        return QImage();
+
+    auto thumbUri = thumbnailUri(uri);
+    if (thumbUri.isEmpty())
+        return QImage();
+
+    QSize box = size.isValid()? size: QSize(THUMBNAIL_NORMAL_SIZE, THUMBNAIL_NORMAL_SIZE);
+    auto name = thumbnailName(thumbUri);
+    QImage image;
+    if (box.width() <= THUMBNAIL_NORMAL_SIZE && box.height() <= THUMBNAIL_NORMAL_SIZE)
+        image = readValidImage(thumbnailsDir() + "/normal/" + name, thumbUri, mtime);
+    if (image.isNull())
+        image = readValidImage(thumbnailsDir() + "/large/" + name, thumbUri, mtime);
+
+    //other applications might have saved a larger thumbnail than the spec allows.
+    if (image.width() > box.width() || image.height() > box.height())
+        image = image.scaled(box, Qt::KeepAspectRatio, Qt::SmoothTransformation);
+    return image;
+}
+
+void ThumbnailDiskCache::saveThumbnail(const QString &uri, quint64 mtime, const QImage &image)
+{
+    if (mtime == 0 || image.isNull())
+        return;
+
+    auto thumbUri = thumbnailUri(uri);
+    if (thumbUri.isEmpty())
+        return;
+
+    writeImage("normal", THUMBNAIL_NORMAL_SIZE, thumbUri, mtime, image);
+    //other applications read large thumbnails at the large size, do not
+    //save an image which would have to be scaled up to fit it.
+    if (image.width() >= THUMBNAIL_LARGE_SIZE || image.height() >= THUMBNAIL_LARGE_SIZE)
+        writeImage("large", THUMBNAIL_LARGE_SIZE, thumbUri, mtime, image);
+}
+
+bool ThumbnailDiskCache::hasFailed(const QString &uri, quint64 mtime)
+{
+    if (mtime == 0)
+        return false;
+
+    auto thumbUri = thumbnailUri(uri);
+    if (thumbUri.isEmpty())
+        return false;
+
+    QImageReader reader(thumbnailsDir() + "/fail/peony-qt/" + thumbnailName(thumbUri), "png");
+    if (!reader.canRead())
+        return false;
+    return reader.text("Thumb::URI") == thumbUri && reader.text("Thumb::MTime").toULongLong() == mtime;
+}
+
+void ThumbnailDiskCache::markFailed(const QString &uri, quint64 mtime)
+{
+    if (mtime == 0)
+        return;
+
+    auto thumbUri = thumbnailUri(uri);
+    if (thumbUri.isEmpty())
+        return;
+
+    //the spec requires a png with the same text keys, the content is not used.
+    QImage image(1, 1, QImage::Format_ARGB32);
+    image.fill(Qt::transparent);
+    writeImage("fail/peony-qt", 1, thumbUri, mtime, image);
+}
+
+QString ThumbnailDiskCache::thumbnailsDir()
+{
+    return QStandardPaths::writableLocation(QStandardPaths::GenericCacheLocation) + "/thumbnails";
+}
+
+QString ThumbnailDiskCache::thumbnailUri(const QString &uri)
+{
+    //use gio's escaping, so that the md5 matches the one computed by other desktop applications.
+    //only local files are canonicalized, the uris of other schemes are kept as they are.
+    GFile *file = g_file_new_for_uri(uri.toUtf8().constData());
+    auto canonicalUri = g_file_get_uri(file);
+    g_object_unref(file);
+    if (!canonicalUri)
+        return nullptr;
+    QString result = canonicalUri;
+    g_free(canonicalUri);
+    return result;
+}
+
+QString ThumbnailDiskCache::thumbnailName(const QString &uri)
+{
+    return QCryptographicHash::hash(uri.toUtf8(), QCryptographicHash::Md5).toHex() + ".png";
+}
+
+QImage ThumbnailDiskCache::readValidImage(const QString &thumbnailPath, const QString &uri, quint64 mtime)
+{
+    QImageReader reader(thumbnailPath, "png");
+    if (!reader.canRead())
+        return QImage();
+
+    //text keys are stored before the image data, check them without decoding.
+    if (reader.text("Thumb::URI") != uri || reader.text("Thumb::MTime").toULongLong() != mtime)
+        return QImage();
+
+    return reader.read();
+}
+
+void ThumbnailDiskCache::writeImage(const QString &flavor, int size, const QString &uri, quint64 mtime, const QImage &image)
+{
+    auto dirPath = thumbnailsDir() + "/" + flavor;
+    QDir dir(dirPath);
+    if (!dir.exists()) {
+        if (!dir.mkpath(dirPath))
+            return;
+        QFile::setPermissions(dirPath, QFile::ReadOwner|QFile::WriteOwner|QFile::ExeOwner);
+    }
+
+    //QSaveFile writes a temporary file and renames it, other processes
+    //will never read an incomplete thumbnail.
+    auto thumbnailPath = dirPath + "/" + thumbnailName(uri);
+    QSaveFile file(thumbnailPath);
+    if (!file.open(QIODevice::WriteOnly))
+        return;
+
+    QImageWriter writer(&file, "png");
+    writer.setText("Thumb::URI", uri);
+    writer.setText("Thumb::MTime", QString::number(mtime));
+    writer.setText("Software", "peony-qt");
+    //every flavor has its own size limit, readers of the cache rely on it.
+    bool fits = image.width() <= size && image.height() <= size;
+    if (!writer.write(fits? image: image.scaled(size, size, Qt::KeepAspectRatio, Qt::SmoothTransformation))) {
+        file.cancelWriting();
+        return;
+    }
+    if (file.commit())
+        QFile::setPermissions(thumbnailPath, QFile::ReadOwner|QFile::WriteOwner);
+}
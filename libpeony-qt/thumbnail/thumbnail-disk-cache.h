@@ -0,0 +1,83 @@
+/*
+ * Peony-Qt's Library
+ *
+ * Copyright (C) 2020, Tianjin KYLIN Information Technology Co., Ltd.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this library.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * Authors: Yue Lan <lanyue@kylinos.cn>
+ *
+ */
+
+#ifndef THUMBNAILDISKCACHE_H
+#define THUMBNAILDISKCACHE_H
+
+#include <QString>
+#include <QImage>
+
+namespace Peony {
+
+/*!
+ * \brief The ThumbnailDiskCache class
+ * <br>
+ * Persistent thumbnail cache shared with other applications, it follows
+ * the freedesktop thumbnail managing standard. Thumbnails are stored in
+ * $XDG_CACHE_HOME/thumbnails/{normal,large} as png files named by the
+ * md5 of the file's uri, and they are validated by the Thumb::URI and
+ * Thumb::MTime text keys. Files which could not be thumbnailed are recorded
+ * in fail/peony-qt, so that we won't try decoding them again until they
+ * are modified.
+ * </br>
+ * \note All methods are thread safe, they are called in thumbnail jobs.
+ */
+class ThumbnailDiskCache
+{
+public:
+    /*!
+     * \brief loadThumbnail
+     * \param uri, uri of the original file, it is not limited to the file scheme.
+     * \param mtime, modified time of the original file, in seconds.
+     * \param size, the box the thumbnail should fit in, the normal size (128x128) is used
+     * if it is invalid. A larger cached thumbnail is scaled down to fit it.
+     * \return the cached thumbnail, or a null image if there is no valid one.
+     */
+    static QImage loadThumbnail(const QString &uri, quint64 mtime, const QSize &size = QSize());
+
+    /*!
+     * \brief saveThumbnail
+     * \param uri
+     * \param mtime
+     * \param image, the thumbnail which has not been decorated (such as shadow).
+     * <br>
+     * The image is scaled to fit the normal size (128x128) and saved to normal
+     * directory. If it reaches the large size (256x256), it is also scaled to
+     * fit that and saved to large directory.
+     * </br>
+     */
+    static void saveThumbnail(const QString &uri, quint64 mtime, const QImage &image);
+
+    static bool hasFailed(const QString &uri, quint64 mtime);
+    static void markFailed(const QString &uri, quint64 mtime);
+
+private:
+    static QString thumbnailsDir();
+    static QString thumbnailUri(const QString &uri);
+    static QString thumbnailName(const QString &uri);
+    static QImage readValidImage(const QString &thumbnailPath, const QString &uri, quint64 mtime);
+    static void writeImage(const QString &flavor, int size, const QString &uri, quint64 mtime, const QImage &image);
+};
+
+}
+
+#endif // THUMBNAILDISKCACHE_H
@@ -26,10 +26,7 @@
 
 #include "file-watcher.h"
 
-#include <QDebug>
-
-static int runCount = 0;
-static int endCount = 0;
+#include <QThreadPool>
 
 Peony::ThumbnailJob::ThumbnailJob(const QString &uri, const std::shared_ptr<Peony::FileWatcher> watcher, QObject *parent):
     QObject(parent), QRunnable()
@@ -45,19 +42,24 @@ Peony::ThumbnailJob::ThumbnailJob(const QString &uri, const std::shared_ptr<Peon
 
 Peony::ThumbnailJob::~ThumbnailJob()
 {
-    endCount++;
-    //qDebug()<<"job end or cancelled. current end"<<endCount<<"current start request:"<<runCount;
+    //if the job is destroyed with its parent before it runs,
+    //it must be removed from the pool queue.
+    auto manager = ThumbnailManager::getInstance();
+#if QT_VERSION >= QT_VERSION_CHECK(5, 9, 0)
+    if (m_thread_pool)
+        m_thread_pool->tryTake(this);
+#endif
+    manager->takePendingJob(this);
 }
 
 void Peony::ThumbnailJob::run()
 {
     if (!parent())
         return;
-    runCount++;
-
-    qDebug()<<"job start, current end:"<<endCount<<"current start request:"<<runCount;
 
     setParent(nullptr);
+    //the job is running, it could not be prioritized or dropped any more.
+    ThumbnailManager::getInstance()->takePendingJob(this);
     auto strongPtr = m_watcher.lock();
     ThumbnailManager::getInstance()->createThumbnailInternal(m_uri, strongPtr);
 }
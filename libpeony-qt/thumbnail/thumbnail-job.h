@@ -29,23 +29,35 @@
 
 #include "peony-core_global.h"
 
+class QThreadPool;
+
 namespace Peony {
 
 class FileWatcher;
 
 class PEONYCORESHARED_EXPORT ThumbnailJob : public QObject, public QRunnable
 {
+    friend class ThumbnailManager;
     Q_OBJECT
 public:
     explicit ThumbnailJob(const QString &uri, const std::shared_ptr<FileWatcher> watcher, QObject *parent = nullptr);
     ~ThumbnailJob();
 
+    const QString uri() {return m_uri;}
+    std::weak_ptr<FileWatcher> watcher() {return m_watcher;}
+
 public Q_SLOTS:
     void run() override;
 
 private:
     QString m_uri;
     std::weak_ptr<FileWatcher> m_watcher;
+
+    /*!
+     * \brief m_thread_pool
+     * The pool which the job is queued in, see ThumbnailManager::startJob().
+     */
+    QThreadPool *m_thread_pool = nullptr;
 };
 
 }
@@ -22,12 +22,12 @@
 
 #include "peony-search-vfs-file-enumerator.h"
 #include "peony-search-vfs-file.h"
-#include "file-enumerator.h"
 #include "search-vfs-manager.h"
+#include "search-crawler.h"
+#include "search-content-matcher.h"
 #include <QDebug>
 #include <QFile>
-#include <QUrl>
-#include <QTextStream>
+#include <QDateTime>
 
 //G_DEFINE_TYPE(PeonySearchVFSFileEnumerator, peony_search_vfs_file_enumerator, G_TYPE_FILE_ENUMERATOR)
 
@@ -38,7 +38,11 @@ G_DEFINE_TYPE_WITH_PRIVATE(PeonySearchVFSFileEnumerator,
 static void peony_search_vfs_file_enumerator_parse_uri(PeonySearchVFSFileEnumerator *enumerator,
                                                        const char *uri);
 
-static gboolean peony_search_vfs_file_enumerator_is_file_match(PeonySearchVFSFileEnumerator *enumerator, std::shared_ptr<Peony::FileInfo> info);
+static gboolean peony_search_vfs_file_enumerator_is_file_match(PeonySearchVFSFileEnumerator *enumerator, const Peony::SearchCrawler::Entry &entry);
+
+static int peony_search_vfs_file_enumerator_rank_file(PeonySearchVFSFileEnumerator *enumerator, const Peony::SearchCrawler::Entry &entry);
+
+static gboolean peony_search_vfs_file_enumerator_has_ready_file(PeonySearchVFSFileEnumerator *enumerator);
 
 /* -- init -- */
 
@@ -48,8 +52,14 @@ static void peony_search_vfs_file_enumerator_init(PeonySearchVFSFileEnumerator *
     self->priv = priv;
 
     self->priv->search_vfs_directory_uri = new QString;
-    self->priv->enumerate_queue = new QQueue<std::shared_ptr<Peony::FileInfo>>;
-    self->priv->name_regexp_extend_list = new QList<QRegExp*>;
+    self->priv->enumerate_queue = new QQueue<QString>;
+    self->priv->index_result_queue = new QQueue<QString>;
+    self->priv->history = new std::shared_ptr<const Peony::SearchHistory>;
+    self->priv->history_position = 0;
+    self->priv->saved_results = new QStringList;
+    self->priv->crawler = nullptr;
+    self->priv->content_matcher = nullptr;
+    self->priv->name_regexp_extend_list = new QList<QRegularExpression*>;
     self->priv->recursive = false;
     self->priv->save_result = false;
     self->priv->search_hidden = true;
@@ -103,13 +113,24 @@ void enumerator_dispose(GObject *object)
 {
     PeonySearchVFSFileEnumerator *self = PEONY_SEARCH_VFS_FILE_ENUMERATOR(object);
 
+    //stop the workers before the details they use are deleted.
+    if (self->priv->crawler) {
+        delete self->priv->crawler;
+        self->priv->crawler = nullptr;
+    }
+
     if (self->priv->name_regexp)
         delete self->priv->name_regexp;
     if (self->priv->content_regexp)
         delete self->priv->content_regexp;
+    if (self->priv->content_matcher)
+        delete self->priv->content_matcher;
     delete self->priv->search_vfs_directory_uri;
     self->priv->enumerate_queue->clear();
     delete self->priv->enumerate_queue;
+    delete self->priv->index_result_queue;
+    delete self->priv->history;
+    delete self->priv->saved_results;
     for(int i=self->priv->name_regexp_extend_list->count()-1; i>=0; i--)
     {
         delete self->priv->name_regexp_extend_list->at(i);
@@ -132,62 +153,71 @@ static GFileInfo *enumerate_next_file(GFileEnumerator *enumerator,
         }
     }
     auto search_enumerator = PEONY_SEARCH_VFS_FILE_ENUMERATOR(enumerator);
-    auto enumerate_queue = search_enumerator->priv->enumerate_queue;
+    auto details = search_enumerator->priv;
 
-    if (manager->hasHistory(*search_enumerator->priv->search_vfs_directory_uri)) {
-        while (!enumerate_queue->isEmpty()) {
-            auto info = enumerate_queue->dequeue();
+    //the history is ranked already.
+    auto history = *details->history;
+    if (history) {
+        if (details->history_position < history->count()) {
             auto search_vfs_info = g_file_info_new();
-            QString realUriSuffix = "real-uri:" + info->uri();
+            QString realUriSuffix = "real-uri:" + history->uriAt(details->history_position++);
             g_file_info_set_name(search_vfs_info, realUriSuffix.toUtf8().constData());
             return search_vfs_info;
         }
         return nullptr;
     }
 
-    while (!enumerate_queue->isEmpty()) {
-        //BFS enumeration
-        auto info = enumerate_queue->dequeue();
-        if (info->isDir() && search_enumerator->priv->recursive) {
-            if (!search_enumerator->priv->search_hidden) {
-                if (!info->uri().contains("/.")) {
-                    Peony::FileEnumerator e;
-                    e.setEnumerateDirectory(info->uri());
-                    e.enumerateSync();
-                    enumerate_queue->append(e.getChildren());
-                }
-            } else {
-                Peony::FileEnumerator e;
-                e.setEnumerateDirectory(info->uri());
-                e.enumerateSync();
-                enumerate_queue->append(e.getChildren());
-            }
-        }
-        //match
-        if (peony_search_vfs_file_enumerator_is_file_match(search_enumerator, info)) {
-            //return this info, and the enumerate get child will return the
-            //file crosponding the real uri, due to it would be handled in
-            //vfs looking up method callback in registed vfs.
-            if (!search_enumerator->priv->search_hidden) {
-                if (!info->uri().contains("/.")) {
-                    goto return_info;
-                }
-            } else {
-return_info:
-                auto search_vfs_info = g_file_info_new();
-                QString realUriSuffix = "real-uri:" + info->uri();
-                g_file_info_set_name(search_vfs_info, realUriSuffix.toUtf8().constData());
-
-                if (search_enumerator->priv->save_result) {
-                    auto historyResults = manager->getHistroyResults(*search_enumerator->priv->search_vfs_directory_uri);
-                    //FIXME: add lock?
-                    historyResults<<realUriSuffix;
-                }
-                return search_vfs_info;
+    if (!details->crawler) {
+        //the matcher and the ranker are called in the crawler's worker threads,
+        //they only read the details, which are not changed after the uri is parsed.
+        details->crawler = new Peony::SearchCrawler([=](const Peony::SearchCrawler::Entry &entry) {
+            return bool(peony_search_vfs_file_enumerator_is_file_match(search_enumerator, entry));
+        }, [=](const Peony::SearchCrawler::Entry &entry) {
+            return peony_search_vfs_file_enumerator_rank_file(search_enumerator, entry);
+        }, details->recursive, details->search_hidden);
+
+        //the index results are ranked with the crawled ones.
+        QList<Peony::SearchCrawler::Entry> found;
+        for (auto uri : *details->index_result_queue) {
+            Peony::SearchCrawler::Entry entry;
+            entry.uri = uri;
+            char *path = g_filename_from_uri(uri.toUtf8().constData(), nullptr, nullptr);
+            if (path) {
+                entry.path = path;
+                g_free(path);
             }
+            entry.displayName = QFile::decodeName(entry.path.mid(entry.path.lastIndexOf('/') + 1));
+            found<<entry;
         }
+        details->index_result_queue->clear();
+
+        details->crawler->start(QStringList(*details->enumerate_queue), found);
+        details->enumerate_queue->clear();
+    }
+
+    Peony::SearchCrawler::Result result;
+    if (details->crawler->takeResult(result, cancellable)) {
+        //return this info, and the enumerate get child will return the
+        //file crosponding the real uri, due to it would be handled in
+        //vfs looking up method callback in registed vfs.
+        auto search_vfs_info = g_file_info_new();
+        QString realUriSuffix = "real-uri:" + result.uri;
+        g_file_info_set_name(search_vfs_info, realUriSuffix.toUtf8().constData());
+
+        if (details->save_result)
+            *details->saved_results<<result.uri;
+        return search_vfs_info;
     }
 
+    if (g_cancellable_set_error_if_cancelled(cancellable, error))
+        return nullptr;
+
+    //only a finished search is saved, so that it is never partial.
+    if (details->save_result) {
+        details->save_result = false;
+        manager->addHistory(*details->search_vfs_directory_uri, *details->saved_results);
+        details->saved_results->clear();
+    }
     return nullptr;
 }
 
@@ -214,6 +244,12 @@ next_files_thread (GTask        *task,
     c = G_FILE_ENUMERATOR_GET_CLASS (enumerator);
     for (i = 0; i < num_files; i++)
     {
+        //return a partial batch rather than waiting for more results, so that
+        //the results are shown as soon as they are found. FileEnumerator keeps
+        //requesting the next files of a search until an empty batch.
+        if (i > 0 && !peony_search_vfs_file_enumerator_has_ready_file(PEONY_SEARCH_VFS_FILE_ENUMERATOR(enumerator)))
+            break;
+
         if (g_cancellable_set_error_if_cancelled (cancellable, &error))
             info = NULL;
         else
@@ -266,32 +302,106 @@ static gboolean enumerator_close(GFileEnumerator *enumerator,
                                  GError **error)
 {
     PeonySearchVFSFileEnumerator *self = PEONY_SEARCH_VFS_FILE_ENUMERATOR(enumerator);
+    if (self->priv->crawler)
+        self->priv->crawler->stop();
 
     return true;
 }
 
-gboolean peony_search_vfs_file_enumerator_is_file_match(PeonySearchVFSFileEnumerator *enumerator, std::shared_ptr<Peony::FileInfo> file_info)
+gboolean peony_search_vfs_file_enumerator_is_file_match(PeonySearchVFSFileEnumerator *enumerator, const Peony::SearchCrawler::Entry &entry)
 {
     PeonySearchVFSFileEnumeratorPrivate *details = enumerator->priv;
     if (!details->name_regexp && !details->content_regexp
         && details->name_regexp_extend_list->count() == 0)
         return false;
 
-    GFile *file = g_file_new_for_uri(file_info->uri().toUtf8().constData());
-    GFileInfo *info = g_file_query_info(file,
-                                        G_FILE_ATTRIBUTE_STANDARD_DISPLAY_NAME,
-                                        G_FILE_QUERY_INFO_NOFOLLOW_SYMLINKS,
-                                        nullptr,
-                                        nullptr);
-    g_object_unref(file);
-
-    char *file_display_name = g_file_info_get_attribute_as_string(info, G_FILE_ATTRIBUTE_STANDARD_DISPLAY_NAME);
-    g_object_unref(info);
-    QString displayName = file_display_name;
-    g_free(file_display_name);
+    //the display name has been got by the crawler.
+    if (peony_search_vfs_file_enumerator_is_name_match(enumerator, entry.displayName))
+        return true;
+
+    if (details->content_matcher && enumerator->priv->match_name_or_content && !entry.isDir) {
+        //only the local files could be read.
+        QByteArray path = entry.path;
+        if (path.isEmpty()) {
+            GFile *file = g_file_new_for_uri(entry.uri.toUtf8().constData());
+            char *tmp = g_file_get_path(file);
+            g_object_unref(file);
+            if (tmp) {
+                path = tmp;
+                g_free(tmp);
+            }
+        }
+        if (!path.isEmpty() && details->content_matcher->matchFile(path))
+            return true;
+    }
+
+    //this may never happend.
+    return false;
+}
+
+int peony_search_vfs_file_enumerator_rank_file(PeonySearchVFSFileEnumerator *enumerator, const Peony::SearchCrawler::Entry &entry)
+{
+    PeonySearchVFSFileEnumeratorPrivate *details = enumerator->priv;
+    Qt::CaseSensitivity sensitivity = details->case_sensitive? Qt::CaseSensitive: Qt::CaseInsensitive;
+    int score = 0;
+
+    //a name same as the key is the best, then a name starts with the key.
+    QStringList keys;
+    if (details->name_regexp)
+        keys<<details->name_regexp->pattern();
+    for (auto regexp : *details->name_regexp_extend_list) {
+        keys<<regexp->pattern();
+    }
+    const QString &name = entry.displayName;
+    int suffixIndex = name.lastIndexOf('.');
+    QString baseName = suffixIndex > 0? name.left(suffixIndex): name;
+    int nameScore = 0;
+    for (auto key : keys) {
+        if (key.isEmpty())
+            continue;
+        if (name.compare(key, sensitivity) == 0 || baseName.compare(key, sensitivity) == 0)
+            nameScore = qMax(nameScore, 1000);
+        else if (name.startsWith(key, sensitivity))
+            nameScore = qMax(nameScore, 500);
+    }
+    score += nameScore;
+
+    //the shallower files are more likely wanted.
+    int depth = entry.path.isEmpty()? entry.uri.count('/'): entry.path.count('/');
+    score -= qMin(depth, 32)*10;
+
+    //so are the recently modified ones.
+    if (entry.modified > 0) {
+        qint64 age = QDateTime::currentMSecsSinceEpoch()/1000 - qint64(entry.modified);
+        if (age < 24*3600)
+            score += 200;
+        else if (age < 7*24*3600)
+            score += 100;
+        else if (age < 30*24*3600)
+            score += 50;
+        else if (age < 365*24*3600)
+            score += 20;
+    }
+
+    return score;
+}
+
+gboolean peony_search_vfs_file_enumerator_has_ready_file(PeonySearchVFSFileEnumerator *enumerator)
+{
+    PeonySearchVFSFileEnumeratorPrivate *details = enumerator->priv;
+    if (*details->history)
+        return details->history_position < (*details->history)->count();
+    if (!details->crawler)
+        return false;
+    return details->crawler->hasReadyResult();
+}
+
+gboolean peony_search_vfs_file_enumerator_is_name_match(PeonySearchVFSFileEnumerator *enumerator, const QString &displayName)
+{
+    PeonySearchVFSFileEnumeratorPrivate *details = enumerator->priv;
     if (details->name_regexp) {
         if (details->use_regexp && details->match_name_or_content
-            && displayName.contains(*enumerator->priv->name_regexp))
+            && details->name_regexp->match(displayName).hasMatch())
         {
             return true;
         }
@@ -312,7 +422,7 @@ gboolean peony_search_vfs_file_enumerator_is_file_match(PeonySearchVFSFileEnumer
             if (! curRegexp)
                 continue;
             if (details->use_regexp && details->match_name_or_content
-                    && displayName.contains(*curRegexp))
+                    && curRegexp->match(displayName).hasMatch())
             {
                return true;
             }
@@ -324,31 +434,5 @@ gboolean peony_search_vfs_file_enumerator_is_file_match(PeonySearchVFSFileEnumer
         }
     }
 
-    if (details->content_regexp) {
-        //read file stream
-        QUrl url = file_info->uri();
-        QFile file(url.path());
-        file.open(QIODevice::Text | QIODevice::ReadOnly);
-        QTextStream stream(&file);
-        bool content_matched = false;
-        QString line;
-        line = stream.readLine();
-        while (!line.isNull()) {
-            if (line.contains(*enumerator->priv->content_regexp)) {
-                content_matched = true;
-                break;
-            }
-            line = stream.readLine();
-        }
-        file.close();
-
-        if (content_matched) {
-            if (enumerator->priv->match_name_or_content) {
-                return true;
-            }
-        }
-    }
-
-    //this may never happend.
     return false;
 }
@@ -26,7 +26,16 @@
 #include <gio/gio.h>
 #include <QQueue>
 #include <QRegExp>
-#include "file-info.h"
+#include <QRegularExpression>
+#include <QString>
+#include <QStringList>
+#include <memory>
+
+namespace Peony {
+class SearchCrawler;
+class SearchContentMatcher;
+class SearchHistory;
+}
 
 G_BEGIN_DECLS
 
@@ -49,11 +58,50 @@ typedef struct {
     gboolean save_result;
     gboolean recursive;
     gboolean case_sensitive;
-    QRegExp *name_regexp;
+    /*!
+     * \brief name_regexp
+     * it is matched in the crawler's worker threads concurrently, QRegularExpression
+     * is compiled once in parsing the uri and then only read in matching.
+     */
+    QRegularExpression *name_regexp;
     QRegExp *content_regexp;
-    QList<QRegExp*> *name_regexp_extend_list;
+    /*!
+     * \brief content_matcher
+     * match the file contents with the pattern of content_regexp, it
+     * reads the files in blocks and skips the binary files.
+     */
+    Peony::SearchContentMatcher *content_matcher;
+    QList<QRegularExpression*> *name_regexp_extend_list;
     gboolean match_name_or_content;
-    QQueue<std::shared_ptr<Peony::FileInfo>> *enumerate_queue;
+    /*!
+     * \brief enumerate_queue
+     * the searched folders which will be crawled.
+     */
+    QQueue<QString> *enumerate_queue;
+    /*!
+     * \brief index_result_queue
+     * the uris found in the filename index, they are ranked together with
+     * the results of crawling the folders which are not covered by the index.
+     */
+    QQueue<QString> *index_result_queue;
+    /*!
+     * \brief history
+     * the results of the same search done before, shared with SearchVFSManager.
+     */
+    std::shared_ptr<const Peony::SearchHistory> *history;
+    int history_position;
+    /*!
+     * \brief saved_results
+     * the returned uris, they are added to the history when the search
+     * is finished if save_result is set.
+     */
+    QStringList *saved_results;
+    /*!
+     * \brief crawler
+     * crawl the folders in enumerate_queue in parallel, it is created when
+     * the first file is requested.
+     */
+    Peony::SearchCrawler *crawler;
 } PeonySearchVFSFileEnumeratorPrivate;
 
 struct _PeonySearchVFSFileEnumerator
@@ -65,4 +113,11 @@ struct _PeonySearchVFSFileEnumerator
 
 G_END_DECLS
 
+/*!
+ * \brief peony_search_vfs_file_enumerator_is_name_match
+ * \return TRUE if \a display_name matches the name regexps of the enumerator.
+ */
+gboolean peony_search_vfs_file_enumerator_is_name_match(PeonySearchVFSFileEnumerator *enumerator,
+                                                        const QString &display_name);
+
 #endif // PEONYSEARCHVFSFILEENUMERATOR_H
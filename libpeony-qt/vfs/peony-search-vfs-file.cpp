@@ -22,8 +22,9 @@
 
 #include "peony-search-vfs-file.h"
 #include "peony-search-vfs-file-enumerator.h"
-#include "file-enumerator.h"
 #include "search-vfs-manager.h"
+#include "search-file-index.h"
+#include "search-content-matcher.h"
 #include <QString>
 #include <QDebug>
 
@@ -191,16 +192,15 @@ void peony_search_vfs_file_enumerator_parse_uri(PeonySearchVFSFileEnumerator *en
     *details->search_vfs_directory_uri = uri;
 
     auto manager = Peony::SearchVFSManager::getInstance();
-    if (manager->hasHistory(uri)) {
-        auto uris = manager->getHistroyResults(uri);
-        for (auto uri: uris) {
-            details->enumerate_queue->enqueue(Peony::FileInfo::fromUri(uri));
-        }
+    auto history = manager->getHistroyResults(uri);
+    if (history) {
+        *details->history = history;
         //do not parse uri, not neccersary
         return;
     }
 
     QStringList args = details->search_vfs_directory_uri->split("&", QString::SkipEmptyParts);
+    QStringList searchUris;
 
     //we should judge case sensitive, then we confirm the regexp when
     //we match file in file enumeration.
@@ -232,7 +232,7 @@ void peony_search_vfs_file_enumerator_parse_uri(PeonySearchVFSFileEnumerator *en
             }
             QString tmp = arg;
             tmp = tmp.remove("name_regexp=");
-            details->name_regexp = new QRegExp(tmp);
+            details->name_regexp = new QRegularExpression(tmp);
             continue;
         }
 
@@ -246,7 +246,7 @@ void peony_search_vfs_file_enumerator_parse_uri(PeonySearchVFSFileEnumerator *en
             QStringList keys = tmp.split(",", QString::SkipEmptyParts);
             for(auto key : keys)
             {
-                details->name_regexp_extend_list->append(new QRegExp(key));
+                details->name_regexp_extend_list->append(new QRegularExpression(key));
             }
             continue;
         }
@@ -281,43 +281,76 @@ void peony_search_vfs_file_enumerator_parse_uri(PeonySearchVFSFileEnumerator *en
             QString tmp = arg;
             tmp.remove("search:///");
             tmp.remove("search_uris=");
-            QStringList uris = tmp.split(",", QString::SkipEmptyParts);
-            for (auto uri: uris) {
-                //NOTE: we should enumerate the search uris and add
-                //the children into queue first. otherwise we could
-                //not judge wether we should search recursively.
-                Peony::FileEnumerator e;
-                e.setEnumerateDirectory(uri);
-                e.enumerateSync();
-                auto infos = e.getChildren();
-                for (auto info : infos) {
-                    details->enumerate_queue->enqueue(info);
-                }
-            }
+            searchUris<<tmp.split(",", QString::SkipEmptyParts);
         }
     }
 
     Qt::CaseSensitivity sensitivity = details->case_sensitive? Qt::CaseSensitive: Qt::CaseInsensitive;
 
+    //the name patterns are compiled here, before the crawler's workers share them.
+    QRegularExpression::PatternOptions nameOptions = details->case_sensitive? QRegularExpression::NoPatternOption:
+                                                                            QRegularExpression::CaseInsensitiveOption;
     if (!details->name_regexp) {
         //details->name_regexp = new QRegExp;
     } else {
-        details->name_regexp->setCaseSensitivity(sensitivity);
+        details->name_regexp->setPatternOptions(nameOptions);
+        details->name_regexp->optimize();
     }
 
     if (!details->content_regexp) {
         //details->content_regexp = new QRegExp;
     } else {
         details->content_regexp->setCaseSensitivity(sensitivity);
+        //compile the content pattern once for all the crawling workers.
+        details->content_matcher = new Peony::SearchContentMatcher(details->content_regexp->pattern(), sensitivity);
     }
 
     if (details->name_regexp_extend_list->count() >0)
     {
         for(int i=0;i<details->name_regexp_extend_list->count();i++)
         {
-            details->name_regexp_extend_list->at(i)->setCaseSensitivity(sensitivity);
+            details->name_regexp_extend_list->at(i)->setPatternOptions(nameOptions);
+            details->name_regexp_extend_list->at(i)->optimize();
         }
     }
+
+    //the index only knows the names, content searches still crawl the folders.
+    auto index = manager->fileIndex();
+    bool useIndex = index && index->isReady() && details->recursive && !details->content_regexp
+            && (details->name_regexp || details->name_regexp_extend_list->count() > 0);
+
+    //a literal key lets the index only check the names containing it.
+    QString literal;
+    if (details->name_regexp && details->name_regexp_extend_list->isEmpty()) {
+        QString pattern = details->name_regexp->pattern();
+        if (!details->use_regexp || QRegExp::escape(pattern) == pattern)
+            literal = pattern;
+    }
+
+    for (auto uri : searchUris) {
+        QStringList crawledUris;
+        bool covered = false;
+        if (useIndex) {
+            GFile *file = g_file_new_for_uri(uri.toUtf8().constData());
+            char *path = g_file_get_path(file);
+            g_object_unref(file);
+            if (path) {
+                QStringList results;
+                covered = index->search(path, [=](const QString &displayName) {
+                    return bool(peony_search_vfs_file_enumerator_is_name_match(enumerator, displayName));
+                }, literal, results, crawledUris);
+                g_free(path);
+                if (covered)
+                    details->index_result_queue->append(results);
+            }
+        }
+        if (!covered)
+            crawledUris = QStringList()<<uri;
+
+        //the crawler enumerates these folders, their children are not
+        //looked up here to avoid creating FileInfo for them.
+        details->enumerate_queue->append(crawledUris);
+    }
 }
 
 GFileEnumerator *peony_search_vfs_file_enumerate_children_internal(GFile *file,
@@ -0,0 +1,322 @@
+/*
+ * Peony-Qt's Library
+ *
+ * Copyright (C) 2020, Tianjin KYLIN Information Technology Co., Ltd.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this library.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * Authors: Yue Lan <lanyue@kylinos.cn>
+ *
+ */
+
+#include "search-content-matcher.h"
+
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <errno.h>
+#include <string.h>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+using namespace Peony;
+
+static inline char asciiLower(char c)
+{
+    return (c >= 'A' && c <= 'Z')? char(c + ('a' - 'A')): c;
+}
+
+static inline bool isAsciiLetter(char c)
+{
+    return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z');
+}
+
+SearchContentMatcher::SearchContentMatcher(const QString &pattern, Qt::CaseSensitivity sensitivity)
+{
+    m_case_insensitive = sensitivity == Qt::CaseInsensitive;
+
+    QRegularExpression::PatternOptions options = QRegularExpression::MultilineOption;
+    if (m_case_insensitive)
+        options |= QRegularExpression::CaseInsensitiveOption;
+    m_regexp = QRegularExpression(pattern, options);
+    //compile it now, instead of in the first match of every worker.
+    m_regexp.optimize();
+
+    bool isLiteral = false;
+    auto literal = requiredLiteral(pattern, &isLiteral);
+    m_literal = literal.toUtf8();
+    if (m_case_insensitive) {
+        bool isAscii = true;
+        for (auto c : m_literal) {
+            if (uchar(c) >= 0x80) {
+                isAscii = false;
+                break;
+            }
+        }
+        //the bytes can only be folded for ascii.
+        if (!isAscii) {
+            m_literal.clear();
+            isLiteral = false;
+        }
+        m_literal = m_literal.toLower();
+    }
+    m_pattern_is_literal = isLiteral && !m_literal.isEmpty();
+}
+
+bool SearchContentMatcher::matchFile(const QByteArray &path) const
+{
+    int fd = open(path.constData(), O_RDONLY|O_CLOEXEC|O_NOCTTY);
+    if (fd < 0)
+        return false;
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode) || st.st_size == 0) {
+        close(fd);
+        return false;
+    }
+    posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+
+    bool matched = false;
+    bool sniffed = false;
+    QByteArray buffer(PEONY_SEARCH_CONTENT_BLOCK_SIZE, Qt::Uninitialized);
+    qint64 kept = 0;
+    while (true) {
+        //a line longer than the buffer.
+        if (kept == buffer.size())
+            buffer.resize(buffer.size()*2);
+
+        auto n = read(fd, buffer.data() + kept, size_t(buffer.size() - kept));
+        if (n < 0) {
+            if (errno == EINTR)
+                continue;
+            break;
+        }
+
+        qint64 size = kept + n;
+        const char *data = buffer.constData();
+        if (!sniffed) {
+            sniffed = true;
+            if (memchr(data, '\0', size_t(qMin<qint64>(size, PEONY_SEARCH_CONTENT_SNIFF_SIZE))))
+                break;
+        }
+        if (size == 0)
+            break;
+
+        //only match the complete lines, the last partial line is kept for the next block.
+        bool eof = n == 0;
+        qint64 complete = size;
+        if (!eof) {
+            auto lastLineEnd = static_cast<const char *>(memrchr(data, '\n', size_t(size)));
+            complete = lastLineEnd? lastLineEnd - data + 1: 0;
+        }
+        if (complete > 0 && matchContent(data, complete)) {
+            matched = true;
+            break;
+        }
+        if (eof)
+            break;
+
+        kept = size - complete;
+        memmove(buffer.data(), data + complete, size_t(kept));
+    }
+
+    close(fd);
+    return matched;
+}
+
+bool SearchContentMatcher::matchContent(const char *data, qint64 size) const
+{
+    const char *end = data + size;
+    const char *p = data;
+    if (m_literal.isEmpty()) {
+        //match every line on its own, a pattern such as "a\s+b" must not span lines.
+        while (p < end) {
+            const char *lineEnd = static_cast<const char *>(memchr(p, '\n', size_t(end - p)));
+            if (!lineEnd)
+                lineEnd = end;
+            if (matchRegExp(p, lineEnd - p))
+                return true;
+            p = lineEnd + 1;
+        }
+        return false;
+    }
+
+    //only the lines containing the literal might match.
+    while (p < end) {
+        const char *found = findLiteral(p, end - p);
+        if (!found)
+            return false;
+        if (m_pattern_is_literal)
+            return true;
+
+        const char *lineStart = static_cast<const char *>(memrchr(data, '\n', size_t(found - data)));
+        lineStart = lineStart? lineStart + 1: data;
+        const char *lineEnd = static_cast<const char *>(memchr(found, '\n', size_t(end - found)));
+        if (!lineEnd)
+            lineEnd = end;
+        if (matchRegExp(lineStart, lineEnd - lineStart))
+            return true;
+        if (lineEnd == end)
+            break;
+        p = lineEnd + 1;
+    }
+    return false;
+}
+
+const char *SearchContentMatcher::findLiteral(const char *data, qint64 size) const
+{
+    const int length = m_literal.size();
+    if (size < length)
+        return nullptr;
+
+    const char first = m_literal.at(0);
+    const char last = m_literal.at(length - 1);
+    qint64 i = 0;
+
+#ifdef __SSE2__
+    //compare the first and the last bytes of the literal at 16 positions at once,
+    //only the positions matching both are compared completely. the letters are
+    //folded by setting the 0x20 bit when the matching is case insensitive.
+    const __m128i firstBytes = _mm_set1_epi8(first);
+    const __m128i lastBytes = _mm_set1_epi8(last);
+    const __m128i firstFold = _mm_set1_epi8((m_case_insensitive && isAsciiLetter(first))? 0x20: 0);
+    const __m128i lastFold = _mm_set1_epi8((m_case_insensitive && isAsciiLetter(last))? 0x20: 0);
+    for (; i + length - 1 + 16 <= size; i += 16) {
+        __m128i firstBlock = _mm_loadu_si128(reinterpret_cast<const __m128i *>(data + i));
+        __m128i lastBlock = _mm_loadu_si128(reinterpret_cast<const __m128i *>(data + i + length - 1));
+        __m128i firstEqual = _mm_cmpeq_epi8(_mm_or_si128(firstBlock, firstFold), firstBytes);
+        __m128i lastEqual = _mm_cmpeq_epi8(_mm_or_si128(lastBlock, lastFold), lastBytes);
+        unsigned mask = unsigned(_mm_movemask_epi8(_mm_and_si128(firstEqual, lastEqual)));
+        while (mask) {
+            int offset = __builtin_ctz(mask);
+            if (isLiteralAt(data + i + offset))
+                return data + i + offset;
+            mask &= mask - 1;
+        }
+    }
+#endif
+
+    for (; i + length <= size; i++) {
+        if (isLiteralAt(data + i))
+            return data + i;
+    }
+    return nullptr;
+}
+
+bool SearchContentMatcher::isLiteralAt(const char *data) const
+{
+    if (!m_case_insensitive)
+        return memcmp(data, m_literal.constData(), size_t(m_literal.size())) == 0;
+
+    for (int i = 0; i < m_literal.size(); i++) {
+        if (asciiLower(data[i]) != m_literal.at(i))
+            return false;
+    }
+    return true;
+}
+
+bool SearchContentMatcher::matchRegExp(const char *data, qint64 size) const
+{
+    //a copy shares the compiled pattern, and it can be used in this thread safely.
+    QRegularExpression regexp = m_regexp;
+
+    //QTextStream::readLine() stripped the whole line end, so "$" matched before "\r".
+    if (size > 0 && data[size - 1] == '\r')
+        size--;
+    QString text = QString::fromUtf8(data, int(size));
+    return regexp.match(text).hasMatch();
+}
+
+QString SearchContentMatcher::requiredLiteral(const QString &pattern, bool *isLiteral)
+{
+    if (isLiteral)
+        *isLiteral = false;
+    //any part of an alternation might be absent.
+    if (pattern.contains('|'))
+        return QString();
+
+    QString best;
+    QString current;
+    int depth = 0;
+    bool plain = true;
+    auto finishRun = [&]() {
+        if (current.length() > best.length())
+            best = current;
+        current.clear();
+    };
+
+    for (int i = 0; i < pattern.length(); i++) {
+        QChar c = pattern.at(i);
+        QChar literal;
+        if (c == '\\') {
+            if (i + 1 >= pattern.length() || pattern.at(i + 1).isLetterOrNumber()) {
+                //character classes, anchors and back references.
+                plain = false;
+                finishRun();
+                i++;
+                continue;
+            }
+            literal = pattern.at(++i);
+        } else if (c == '[') {
+            plain = false;
+            finishRun();
+            int j = i + 1;
+            if (j < pattern.length() && pattern.at(j) == '^')
+                j++;
+            if (j < pattern.length() && pattern.at(j) == ']')
+                j++;
+            while (j < pattern.length() && pattern.at(j) != ']') {
+                if (pattern.at(j) == '\\')
+                    j++;
+                j++;
+            }
+            i = j;
+            continue;
+        } else if (c == '(' || c == ')') {
+            //the groups might be optional, do not look into them.
+            plain = false;
+            finishRun();
+            depth = c == '('? depth + 1: qMax(0, depth - 1);
+            continue;
+        } else if (c == '?' || c == '*' || c == '{') {
+            //the previous character is optional.
+            plain = false;
+            if (!current.isEmpty())
+                current.chop(1);
+            finishRun();
+            if (c == '{') {
+                while (i < pattern.length() && pattern.at(i) != '}')
+                    i++;
+            }
+            continue;
+        } else if (c == '+' || c == '.' || c == '^' || c == '$') {
+            plain = false;
+            finishRun();
+            continue;
+        } else {
+            literal = c;
+        }
+
+        if (depth == 0)
+            current.append(literal);
+    }
+    finishRun();
+
+    if (isLiteral)
+        *isLiteral = plain && !best.isEmpty();
+    return best;
+}
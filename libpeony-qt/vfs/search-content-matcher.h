@@ -0,0 +1,96 @@
+/*
+ * Peony-Qt's Library
+ *
+ * Copyright (C) 2020, Tianjin KYLIN Information Technology Co., Ltd.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this library.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * Authors: Yue Lan <lanyue@kylinos.cn>
+ *
+ */
+
+#ifndef SEARCHCONTENTMATCHER_H
+#define SEARCHCONTENTMATCHER_H
+
+#include <QByteArray>
+#include <QString>
+#include <QRegularExpression>
+
+//the size of the head which is checked for NUL bytes, like grep.
+#ifndef PEONY_SEARCH_CONTENT_SNIFF_SIZE
+#define PEONY_SEARCH_CONTENT_SNIFF_SIZE (8*1024)
+#endif
+
+//files are read in blocks of this size, the lines are not split between blocks.
+#ifndef PEONY_SEARCH_CONTENT_BLOCK_SIZE
+#define PEONY_SEARCH_CONTENT_BLOCK_SIZE (1024*1024)
+#endif
+
+namespace Peony {
+
+/*!
+ * \brief The SearchContentMatcher class
+ * <br>
+ * Match the content of local files with a regexp, which is compiled once
+ * for a search. A file is read in large blocks of raw bytes, and the files
+ * having NUL bytes in their heads are treated as binaries and skipped.
+ * The files are not memory mapped, a mapped file truncated by another
+ * process would crash the file manager with SIGBUS.
+ * </br>
+ * <br>
+ * If the regexp requires a literal string, such as "main" in "int main\(",
+ * the raw bytes are scanned for the literal first (with SSE2 if available),
+ * and only the lines containing it are decoded and matched by the regexp.
+ * If the regexp is the literal itself, the regexp is not used at all.
+ * </br>
+ * \note The text is decoded as UTF-8 and matched line by line, the same
+ * as the former QTextStream based matching. The matcher is thread safe.
+ */
+class SearchContentMatcher
+{
+public:
+    explicit SearchContentMatcher(const QString &pattern, Qt::CaseSensitivity sensitivity);
+
+    bool isValid() const {return m_regexp.isValid();}
+
+    /*!
+     * \brief matchFile
+     * \param path, the local path of the file.
+     * \return true if the file is a text file and its content matches.
+     */
+    bool matchFile(const QByteArray &path) const;
+
+    /*!
+     * \brief requiredLiteral
+     * \return the longest literal which must be in the matched text, or an
+     * empty string if it could not be found out.
+     */
+    static QString requiredLiteral(const QString &pattern, bool *isLiteral = nullptr);
+
+private:
+    bool matchContent(const char *data, qint64 size) const;
+    const char *findLiteral(const char *data, qint64 size) const;
+    bool isLiteralAt(const char *data) const;
+    bool matchRegExp(const char *data, qint64 size) const;
+
+    QRegularExpression m_regexp;
+    //lower case if the matching is case insensitive.
+    QByteArray m_literal;
+    bool m_case_insensitive = false;
+    bool m_pattern_is_literal = false;
+};
+
+}
+
+#endif // SEARCHCONTENTMATCHER_H
@@ -0,0 +1,393 @@
+/*
+ * Peony-Qt's Library
+ *
+ * Copyright (C) 2020, Tianjin KYLIN Information Technology Co., Ltd.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this library.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * Authors: Yue Lan <lanyue@kylinos.cn>
+ *
+ */
+
+#include "search-crawler.h"
+
+#include <QThread>
+#include <QFile>
+
+#include <sys/stat.h>
+#include <dirent.h>
+#include <fcntl.h>
+#include <string.h>
+
+#include <algorithm>
+
+using namespace Peony;
+
+namespace Peony {
+
+/*!
+ * \brief The SearchCrawlWorker class
+ * A worker of crawling, see SearchCrawler.
+ */
+class SearchCrawlWorker : public QRunnable
+{
+public:
+    explicit SearchCrawlWorker(SearchCrawler *crawler) {
+        m_crawler = crawler;
+    }
+
+    void run() override {
+        SearchCrawler::Entry task;
+        while (m_crawler->takeTask(task)) {
+            QList<SearchCrawler::Entry> stack;
+            stack<<task;
+            QVector<SearchCrawler::Result> results;
+            while (!stack.isEmpty() && !m_crawler->isStopped()) {
+                auto entry = stack.takeLast();
+                visit(entry, stack, results);
+
+                if (!results.isEmpty())
+                    m_crawler->pushResults(results);
+
+                if (stack.count() > 1 && m_crawler->hasIdleWorker())
+                    m_crawler->shareTasks(stack);
+            }
+            m_crawler->finishTask();
+        }
+    }
+
+private:
+    void visit(const SearchCrawler::Entry &entry, QList<SearchCrawler::Entry> &stack, QVector<SearchCrawler::Result> &results) {
+        bool hidden = entry.path.contains("/.") || entry.uri.contains("/.");
+        if (hidden && !m_crawler->m_search_hidden)
+            return;
+
+        if (entry.isDir && (entry.isRoot || m_crawler->m_recursive)) {
+            if (!entry.path.isEmpty())
+                readLocalFolder(entry.path, stack);
+            else
+                enumerateFolder(entry.uri, stack);
+        }
+
+        if (entry.isRoot || !m_crawler->m_matcher(entry))
+            return;
+
+        SearchCrawler::Result result;
+        if (m_crawler->rankEntry(entry, result))
+            results<<result;
+    }
+
+    void readLocalFolder(const QByteArray &path, QList<SearchCrawler::Entry> &stack) {
+        DIR *dir = opendir(path.constData());
+        if (!dir)
+            return;
+
+        int fd = dirfd(dir);
+        while (auto ent = readdir(dir)) {
+            if (strcmp(ent->d_name, ".") == 0 || strcmp(ent->d_name, "..") == 0)
+                continue;
+
+            //the symbolic links are not followed, they might make loops.
+            bool isDir = ent->d_type == DT_DIR;
+            if (ent->d_type == DT_UNKNOWN) {
+                struct stat st;
+                isDir = fstatat(fd, ent->d_name, &st, AT_SYMLINK_NOFOLLOW) == 0 && S_ISDIR(st.st_mode);
+            }
+
+            SearchCrawler::Entry child;
+            child.path = path;
+            if (!child.path.endsWith('/'))
+                child.path.append('/');
+            child.path.append(ent->d_name);
+            child.displayName = QFile::decodeName(ent->d_name);
+            child.isDir = isDir;
+            stack<<child;
+        }
+        closedir(dir);
+    }
+
+    void enumerateFolder(const QString &uri, QList<SearchCrawler::Entry> &stack) {
+        GFile *folder = g_file_new_for_uri(uri.toUtf8().constData());
+        GFileEnumerator *enumerator = g_file_enumerate_children(folder,
+                                                                G_FILE_ATTRIBUTE_STANDARD_NAME ","
+                                                                G_FILE_ATTRIBUTE_STANDARD_DISPLAY_NAME ","
+                                                                G_FILE_ATTRIBUTE_STANDARD_TYPE ","
+                                                                G_FILE_ATTRIBUTE_TIME_MODIFIED,
+                                                                G_FILE_QUERY_INFO_NOFOLLOW_SYMLINKS,
+                                                                nullptr,
+                                                                nullptr);
+        g_object_unref(folder);
+        if (!enumerator)
+            return;
+
+        while (GFileInfo *info = g_file_enumerator_next_file(enumerator, nullptr, nullptr)) {
+            if (m_crawler->isStopped()) {
+                g_object_unref(info);
+                break;
+            }
+            GFile *file = g_file_enumerator_get_child(enumerator, info);
+            char *childUri = g_file_get_uri(file);
+            g_object_unref(file);
+
+            SearchCrawler::Entry child;
+            child.uri = childUri;
+            child.displayName = g_file_info_get_display_name(info);
+            child.isDir = g_file_info_get_file_type(info) == G_FILE_TYPE_DIRECTORY;
+            child.modified = g_file_info_get_attribute_uint64(info, G_FILE_ATTRIBUTE_TIME_MODIFIED);
+            stack<<child;
+
+            g_free(childUri);
+            g_object_unref(info);
+        }
+        g_file_enumerator_close(enumerator, nullptr, nullptr);
+        g_object_unref(enumerator);
+    }
+
+    SearchCrawler *m_crawler;
+};
+
+}
+
+bool SearchCrawler::lessRanked(const RankedResult &left, const RankedResult &right)
+{
+    if (left.result.score != right.result.score)
+        return left.result.score < right.result.score;
+    return left.order > right.order;
+}
+
+SearchCrawler::SearchCrawler(const Matcher &matcher, const Ranker &ranker, bool recursive, bool searchHidden)
+{
+    m_matcher = matcher;
+    m_ranker = ranker;
+    m_recursive = recursive;
+    m_search_hidden = searchHidden;
+    m_result_batches.store(nullptr);
+}
+
+SearchCrawler::~SearchCrawler()
+{
+    stop();
+    m_pool.waitForDone();
+
+    auto batch = m_result_batches.fetchAndStoreAcquire(nullptr);
+    while (batch) {
+        auto next = batch->next;
+        delete batch;
+        batch = next;
+    }
+}
+
+void SearchCrawler::start(const QStringList &uris, const QList<Entry> &found)
+{
+    m_rank_timer.start();
+
+    QVector<Result> results;
+    for (auto entry : found) {
+        bool hidden = entry.path.contains("/.") || entry.uri.contains("/.");
+        if (hidden && !m_search_hidden)
+            continue;
+        Result result;
+        if (rankEntry(entry, result))
+            results<<result;
+    }
+    if (!results.isEmpty())
+        pushResults(results);
+
+    for (auto uri : uris) {
+        Entry root;
+        GFile *file = g_file_new_for_uri(uri.toUtf8().constData());
+        char *path = g_file_get_path(file);
+        g_object_unref(file);
+        if (path) {
+            root.path = path;
+            g_free(path);
+        } else {
+            root.uri = uri;
+        }
+        root.isDir = true;
+        root.isRoot = true;
+        m_shared_tasks<<root;
+    }
+    if (m_shared_tasks.isEmpty()) {
+        m_finished.store(1);
+        return;
+    }
+
+    int workerCount = qBound(1, QThread::idealThreadCount(), PEONY_SEARCH_MAX_THREAD_COUNT);
+    m_pool.setMaxThreadCount(workerCount);
+    for (int i = 0; i < workerCount; i++) {
+        m_pool.start(new SearchCrawlWorker(this));
+    }
+}
+
+void SearchCrawler::stop()
+{
+    m_stopped.store(1);
+    //wake the idle workers, so that they can quit.
+    QMutexLocker locker(&m_task_mutex);
+    m_task_cond.wakeAll();
+}
+
+bool SearchCrawler::takeResult(Result &result, GCancellable *cancellable)
+{
+    while (true) {
+        collectResults();
+        if (isResultReady())
+            break;
+        if (m_all_collected && m_results.isEmpty())
+            return false;
+        if (cancellable && g_cancellable_is_cancelled(cancellable))
+            return false;
+
+        //wake up at the end of the ranking window if there are results.
+        int timeout = PEONY_SEARCH_WAIT_INTERVAL;
+        if (!m_results.isEmpty())
+            timeout = int(qBound<qint64>(1, PEONY_SEARCH_RANK_WINDOW - m_rank_timer.elapsed(), timeout));
+        m_result_semaphore.tryAcquire(1, timeout);
+    }
+
+    std::pop_heap(m_results.begin(), m_results.end(), lessRanked);
+    result = m_results.takeLast().result;
+    return true;
+}
+
+bool SearchCrawler::hasReadyResult()
+{
+    collectResults();
+    return isResultReady();
+}
+
+QString SearchCrawler::uriOf(const Entry &entry)
+{
+    if (!entry.uri.isEmpty())
+        return entry.uri;
+
+    //the uris of the local files are only made for the matched ones.
+    QString uri;
+    char *tmp = g_filename_to_uri(entry.path.constData(), nullptr, nullptr);
+    if (tmp) {
+        uri = tmp;
+        g_free(tmp);
+    }
+    return uri;
+}
+
+bool SearchCrawler::rankEntry(const Entry &entry, Result &result)
+{
+    result.uri = uriOf(entry);
+    if (result.uri.isEmpty())
+        return false;
+
+    if (entry.modified == 0 && !entry.path.isEmpty()) {
+        Entry stated = entry;
+        struct stat st;
+        if (lstat(entry.path.constData(), &st) == 0)
+            stated.modified = quint64(st.st_mtime);
+        result.score = m_ranker(stated);
+    } else {
+        result.score = m_ranker(entry);
+    }
+    return true;
+}
+
+void SearchCrawler::collectResults()
+{
+    //all results are pushed before the crawler is finished, so the
+    //flag is read before taking them.
+    bool finished = m_finished.load() != 0;
+
+    //the batches are pushed in front, reverse them to keep the order.
+    auto batch = m_result_batches.fetchAndStoreAcquire(nullptr);
+    QList<ResultBatch *> batches;
+    while (batch) {
+        batches.prepend(batch);
+        batch = batch->next;
+    }
+    for (auto taken : batches) {
+        for (auto result : taken->results) {
+            RankedResult ranked;
+            ranked.result = result;
+            ranked.order = m_result_count++;
+            m_results.append(ranked);
+            std::push_heap(m_results.begin(), m_results.end(), lessRanked);
+        }
+        delete taken;
+    }
+
+    if (finished)
+        m_all_collected = true;
+}
+
+bool SearchCrawler::isResultReady()
+{
+    if (m_results.isEmpty())
+        return false;
+    return m_all_collected || m_rank_timer.elapsed() >= PEONY_SEARCH_RANK_WINDOW;
+}
+
+bool SearchCrawler::takeTask(Entry &task)
+{
+    QMutexLocker locker(&m_task_mutex);
+    while (m_shared_tasks.isEmpty()) {
+        if (m_busy_worker_count == 0 || isStopped()) {
+            if (m_finished.testAndSetOrdered(0, 1))
+                m_result_semaphore.release();
+            m_task_cond.wakeAll();
+            return false;
+        }
+        m_idle_worker_count.ref();
+        m_task_cond.wait(&m_task_mutex);
+        m_idle_worker_count.deref();
+    }
+    if (isStopped())
+        return false;
+    task = m_shared_tasks.takeLast();
+    m_busy_worker_count++;
+    return true;
+}
+
+void SearchCrawler::shareTasks(QList<Entry> &tasks)
+{
+    //the first ones are the shallowest folders, they are likely
+    //to have larger subtrees.
+    int count = tasks.count()/2;
+    QMutexLocker locker(&m_task_mutex);
+    for (int i = 0; i < count; i++) {
+        m_shared_tasks.prepend(tasks.takeFirst());
+    }
+    m_task_cond.wakeAll();
+}
+
+void SearchCrawler::finishTask()
+{
+    QMutexLocker locker(&m_task_mutex);
+    m_busy_worker_count--;
+    if (m_busy_worker_count == 0 && m_shared_tasks.isEmpty())
+        m_task_cond.wakeAll();
+}
+
+void SearchCrawler::pushResults(QVector<Result> &results)
+{
+    auto batch = new ResultBatch;
+    batch->results.swap(results);
+
+    //push only, the consumer takes the whole list, so there is no ABA problem.
+    ResultBatch *head;
+    do {
+        head = m_result_batches.loadAcquire();
+        batch->next = head;
+    } while (!m_result_batches.testAndSetRelease(head, batch));
+
+    m_result_semaphore.release();
+}
@@ -0,0 +1,210 @@
+/*
+ * Peony-Qt's Library
+ *
+ * Copyright (C) 2020, Tianjin KYLIN Information Technology Co., Ltd.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this library.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * Authors: Yue Lan <lanyue@kylinos.cn>
+ *
+ */
+
+#ifndef SEARCHCRAWLER_H
+#define SEARCHCRAWLER_H
+
+#include <QList>
+#include <QStringList>
+#include <QByteArray>
+#include <QMutex>
+#include <QWaitCondition>
+#include <QSemaphore>
+#include <QAtomicInteger>
+#include <QAtomicPointer>
+#include <QThreadPool>
+#include <QVector>
+#include <QElapsedTimer>
+
+#include <gio/gio.h>
+
+#include <functional>
+
+#ifndef PEONY_SEARCH_MAX_THREAD_COUNT
+#define PEONY_SEARCH_MAX_THREAD_COUNT 8
+#endif
+
+//in milliseconds, how often a waiting consumer checks the cancellable.
+#ifndef PEONY_SEARCH_WAIT_INTERVAL
+#define PEONY_SEARCH_WAIT_INTERVAL 100
+#endif
+
+//in milliseconds, the results found in this time after starting are ranked
+//together before the first one is taken.
+#ifndef PEONY_SEARCH_RANK_WINDOW
+#define PEONY_SEARCH_RANK_WINDOW 200
+#endif
+
+namespace Peony {
+
+class SearchCrawlWorker;
+
+/*!
+ * \brief The SearchCrawler class
+ * <br>
+ * Crawl the folders of a search with a pool of workers. Every worker visits
+ * the files in its own stack depth first: a file is matched, and a folder is
+ * enumerated and its children are pushed to the stack. When other workers
+ * are idle, a worker shares the shallower half of its stack with them, so
+ * the subfolders are enumerated concurrently.
+ * </br>
+ * <br>
+ * The crawler does not create FileInfo for the visited files, they would
+ * be kept in the global FileInfoManager hash. A file is only recorded by
+ * its path (local files) or uri, its display name and its type. The local
+ * folders are read with readdir(), the others are enumerated with gio.
+ * </br>
+ * <br>
+ * The matched uris are scored by the ranker in the workers, and pushed to a
+ * lock-free list in batches, one batch per enumerated folder. The consumer
+ * takes the whole list at once, so the workers never wait for it.
+ * </br>
+ * <br>
+ * The consumer keeps the taken results in a heap, and takeResult() returns
+ * the best one it has. The results found in the first PEONY_SEARCH_RANK_WINDOW
+ * milliseconds are ranked together, after that a result is returned as soon
+ * as it is found, unless better ones are found at the same time.
+ * </br>
+ * \note The matcher and the ranker are called in the worker threads concurrently.
+ */
+class SearchCrawler
+{
+    friend class SearchCrawlWorker;
+public:
+    /*!
+     * \brief The Entry struct
+     * A visited file, \a path is set for the local files, \a uri is set for
+     * the others. Both are set for the results found before crawling.
+     */
+    struct Entry {
+        QByteArray path;
+        QString uri;
+        QString displayName;
+        bool isDir = false;
+        //the searched folders are enumerated even if the crawling is not
+        //recursive, and they are not matched themselves.
+        bool isRoot = false;
+        //in seconds since epoch, 0 if it is unknown.
+        quint64 modified = 0;
+    };
+
+    struct Result {
+        QString uri;
+        int score = 0;
+    };
+
+    typedef std::function<bool (const Entry &entry)> Matcher;
+    /*!
+     * \brief Ranker
+     * return the relevance of a matched entry, the higher is the better.
+     */
+    typedef std::function<int (const Entry &entry)> Ranker;
+
+    explicit SearchCrawler(const Matcher &matcher, const Ranker &ranker, bool recursive, bool searchHidden);
+    /*!
+     * \brief ~SearchCrawler
+     * stop the crawling and wait for the workers.
+     */
+    ~SearchCrawler();
+
+    /*!
+     * \brief start
+     * \param uris, the searched folders.
+     * \param found, the matched files already known, such as the results
+     * of the filename index. They are ranked with the crawled ones.
+     */
+    void start(const QStringList &uris, const QList<Entry> &found = QList<Entry>());
+    void stop();
+
+    /*!
+     * \brief takeResult
+     * \param result, the best result found so far.
+     * \param cancellable
+     * \return false if the crawling is finished and all results are taken,
+     * or the \a cancellable is cancelled.
+     * <br>
+     * Block until there is a result ready.
+     * </br>
+     */
+    bool takeResult(Result &result, GCancellable *cancellable);
+    /*!
+     * \brief hasReadyResult
+     * \return true if takeResult() would return a result without waiting.
+     */
+    bool hasReadyResult();
+
+    static QString uriOf(const Entry &entry);
+
+protected:
+    bool takeTask(Entry &task);
+    void shareTasks(QList<Entry> &tasks);
+    void finishTask();
+    bool hasIdleWorker() {return m_idle_worker_count.load() > 0;}
+    bool isStopped() {return m_stopped.load() != 0;}
+
+    void pushResults(QVector<Result> &results);
+
+private:
+    struct ResultBatch {
+        QVector<Result> results;
+        ResultBatch *next;
+    };
+
+    struct RankedResult {
+        Result result;
+        //the results with the same score are kept in the found order.
+        quint64 order = 0;
+    };
+
+    static bool lessRanked(const RankedResult &left, const RankedResult &right);
+    bool rankEntry(const Entry &entry, Result &result);
+    void collectResults();
+    bool isResultReady();
+
+    Matcher m_matcher;
+    Ranker m_ranker;
+    bool m_recursive;
+    bool m_search_hidden;
+
+    QThreadPool m_pool;
+    QAtomicInt m_stopped = 0;
+    QAtomicInt m_finished = 0;
+
+    QList<Entry> m_shared_tasks;
+    int m_busy_worker_count = 0;
+    QAtomicInt m_idle_worker_count = 0;
+    QMutex m_task_mutex;
+    QWaitCondition m_task_cond;
+
+    //pushed by the workers, taken by the consumer.
+    QAtomicPointer<ResultBatch> m_result_batches;
+    QSemaphore m_result_semaphore;
+    //only used by the consumer, a heap of the best results.
+    QVector<RankedResult> m_results;
+    quint64 m_result_count = 0;
+    bool m_all_collected = false;
+    QElapsedTimer m_rank_timer;
+};
+
+}
+
+#endif // SEARCHCRAWLER_H
@@ -0,0 +1,582 @@
+/*
+ * Peony-Qt's Library
+ *
+ * Copyright (C) 2020, Tianjin KYLIN Information Technology Co., Ltd.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this library.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * Authors: Yue Lan <lanyue@kylinos.cn>
+ *
+ */
+
+#include "search-file-index.h"
+
+#include <QSocketNotifier>
+#include <QTimer>
+#include <QFile>
+#include <QSaveFile>
+#include <QFileInfo>
+#include <QDataStream>
+#include <QDir>
+#include <QStandardPaths>
+#include <QDebug>
+
+#include <gio/gio.h>
+
+#include <sys/inotify.h>
+#include <sys/stat.h>
+#include <dirent.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <errno.h>
+#include <string.h>
+
+#include <algorithm>
+
+#define INVALID_ID quint32(0xffffffff)
+
+#define SEARCH_INDEX_MAGIC quint32(0x50534649)
+#define SEARCH_INDEX_VERSION quint32(1)
+
+#define WATCH_MASK (IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO | \
+    IN_DELETE_SELF | IN_MOVE_SELF | IN_ONLYDIR | IN_DONT_FOLLOW | IN_EXCL_UNLINK)
+
+//the deleted entries are only marked, the index is rebuilt when there are too many of them.
+#define MAX_DELETED_COUNT 100000
+
+using namespace Peony;
+
+static int maxUserWatches()
+{
+    QFile file("/proc/sys/fs/inotify/max_user_watches");
+    if (file.open(QIODevice::ReadOnly)) {
+        bool ok = false;
+        int count = file.readAll().trimmed().toInt(&ok);
+        if (ok && count > 0)
+            return count;
+    }
+    //the kernel's default.
+    return 8192;
+}
+
+SearchFileIndex::SearchFileIndex(const QString &rootPath, QObject *parent) : QObject(parent)
+{
+    m_root_path = QDir::cleanPath(rootPath);
+}
+
+SearchFileIndex::~SearchFileIndex()
+{
+    if (m_inotify_fd >= 0)
+        close(m_inotify_fd);
+}
+
+bool SearchFileIndex::isReady()
+{
+    QReadLocker locker(&m_lock);
+    return m_ready;
+}
+
+bool SearchFileIndex::search(const QString &dirPath,
+                             const std::function<bool (const QString &)> &matcher,
+                             const QString &literal,
+                             QStringList &results,
+                             QStringList &uncoveredDirs)
+{
+    QReadLocker locker(&m_lock);
+    if (!m_ready || m_data.entries.isEmpty())
+        return false;
+
+    QByteArray root = QFile::encodeName(m_root_path);
+    QByteArray dir = QFile::encodeName(QDir::cleanPath(dirPath));
+    if (dir != root && !dir.startsWith(root + "/"))
+        return false;
+
+    //find the folder of dirPath, it must be indexed.
+    quint32 dirId = 0;
+    if (m_data.entries.at(0).flags & Unindexed)
+        return false;
+    for (auto component : dir.mid(root.length()).split('/')) {
+        if (component.isEmpty())
+            continue;
+        dirId = findChild(m_data, dirId, component);
+        if (dirId == INVALID_ID)
+            return false;
+        auto flags = m_data.entries.at(dirId).flags;
+        if (!(flags & Folder) || (flags & Unindexed))
+            return false;
+    }
+
+    auto isInDir = [&](quint32 id) {
+        quint32 parent = m_data.entries.at(id).parent;
+        while (parent != INVALID_ID) {
+            if (parent == dirId)
+                return true;
+            parent = m_data.entries.at(parent).parent;
+        }
+        return false;
+    };
+
+    auto uriOf = [&](const QByteArray &path) {
+        QString uri;
+        char *tmp = g_filename_to_uri(path.constData(), nullptr, nullptr);
+        if (tmp) {
+            uri = tmp;
+            g_free(tmp);
+        }
+        return uri;
+    };
+
+    for (int i = 0; i < m_data.entries.count(); i++) {
+        auto &entry = m_data.entries.at(i);
+        if ((entry.flags & Unindexed) && !(entry.flags & Deleted) && isInDir(quint32(i)))
+            uncoveredDirs<<uriOf(pathOf(m_data, quint32(i)));
+    }
+
+    //intersect the posting lists of the literal's trigrams, from the shortest one.
+    QVector<quint32> candidates;
+    bool useCandidates = false;
+    auto keys = trigramsOf(literal.toLower().toUtf8());
+    if (!keys.isEmpty()) {
+        QVector<const QVector<quint32> *> lists;
+        for (auto key : keys) {
+            auto it = m_data.trigrams.constFind(key);
+            if (it == m_data.trigrams.constEnd())
+                return true;
+            lists<<&it.value();
+        }
+        std::sort(lists.begin(), lists.end(), [](const QVector<quint32> *a, const QVector<quint32> *b) {
+            return a->count() < b->count();
+        });
+        candidates = *lists.first();
+        for (int i = 1; i < lists.count() && !candidates.isEmpty(); i++) {
+            QVector<quint32> intersected;
+            for (auto id : candidates) {
+                if (std::binary_search(lists.at(i)->constBegin(), lists.at(i)->constEnd(), id))
+                    intersected<<id;
+            }
+            candidates = intersected;
+        }
+        useCandidates = true;
+    }
+
+    int count = useCandidates? candidates.count(): m_data.entries.count();
+    for (int i = 0; i < count; i++) {
+        quint32 id = useCandidates? candidates.at(i): quint32(i);
+        auto &entry = m_data.entries.at(id);
+        if ((entry.flags & Deleted) || id == dirId)
+            continue;
+        if (!isInDir(id))
+            continue;
+        if (!matcher(QFile::decodeName(entry.name)))
+            continue;
+
+        auto path = pathOf(m_data, id);
+        if (m_stale) {
+            //the saved index might be out of date.
+            struct stat st;
+            if (lstat(path.constData(), &st) != 0)
+                continue;
+        }
+        auto uri = uriOf(path);
+        if (!uri.isEmpty())
+            results<<uri;
+    }
+    return true;
+}
+
+void SearchFileIndex::start()
+{
+    m_save_timer = new QTimer(this);
+    m_save_timer->setSingleShot(true);
+    m_save_timer->setInterval(PEONY_SEARCH_INDEX_SAVE_INTERVAL);
+    connect(m_save_timer, &QTimer::timeout, this, &SearchFileIndex::save);
+
+    m_rescan_timer = new QTimer(this);
+    m_rescan_timer->setSingleShot(true);
+    m_rescan_timer->setInterval(PEONY_SEARCH_INDEX_RESCAN_DELAY);
+    connect(m_rescan_timer, &QTimer::timeout, this, &SearchFileIndex::rescan);
+
+    //the loaded index is used while rescanning.
+    load();
+    rescan();
+}
+
+void SearchFileIndex::save()
+{
+    if (!m_dirty)
+        return;
+
+    //the index lists the names in private folders too, such as ~/.ssh,
+    //so only the owner could read it.
+    auto path = indexFilePath();
+    g_mkdir_with_parents(QFile::encodeName(QFileInfo(path).absolutePath()).constData(), 0700);
+    QSaveFile file(path);
+    if (!file.open(QIODevice::WriteOnly))
+        return;
+    file.setPermissions(QFileDevice::ReadOwner|QFileDevice::WriteOwner);
+
+    QDataStream stream(&file);
+    {
+        QReadLocker locker(&m_lock);
+        if (!m_ready || m_stale)
+            return;
+
+        //the deleted entries are dropped, the parents are always saved before their children.
+        QVector<quint32> newIds(m_data.entries.count(), INVALID_ID);
+        quint32 count = 0;
+        for (int i = 0; i < m_data.entries.count(); i++) {
+            if (!(m_data.entries.at(i).flags & Deleted))
+                newIds[i] = count++;
+        }
+
+        stream<<SEARCH_INDEX_MAGIC<<SEARCH_INDEX_VERSION<<m_root_path<<count;
+        for (auto entry : m_data.entries) {
+            if (entry.flags & Deleted)
+                continue;
+            quint32 parent = entry.parent == INVALID_ID? INVALID_ID: newIds.at(entry.parent);
+            stream<<parent<<entry.flags<<entry.name;
+        }
+    }
+
+    if (stream.status() == QDataStream::Ok && file.commit())
+        m_dirty = false;
+}
+
+void SearchFileIndex::rescan()
+{
+    auto rootPath = QFile::encodeName(m_root_path);
+    struct stat st;
+    if (stat(rootPath.constData(), &st) != 0)
+        return;
+    m_root_device = quint64(st.st_dev);
+
+    int fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (fd < 0) {
+        qWarning()<<"search index: inotify is not available"<<g_strerror(errno);
+        return;
+    }
+
+    //the limit might be changed by sysctl.
+    m_max_watch_count = qMax(1, maxUserWatches()/PEONY_SEARCH_INDEX_WATCH_RATIO);
+    m_watch_limit_reached = false;
+
+    IndexData data;
+    addEntry(data, INVALID_ID, rootPath, Folder);
+    scanFolder(data, fd, 0, rootPath);
+
+    {
+        QWriteLocker locker(&m_lock);
+        m_data = data;
+        m_ready = true;
+        m_stale = false;
+    }
+    setInotifyFd(fd);
+
+    m_dirty = true;
+    save();
+}
+
+void SearchFileIndex::onInotifyEventsReady()
+{
+    alignas(struct inotify_event) char buffer[64*1024];
+    bool rescanNeeded = false;
+
+    QWriteLocker locker(&m_lock);
+    while (true) {
+        auto n = read(m_inotify_fd, buffer, sizeof(buffer));
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n <= 0)
+            break;
+
+        for (char *p = buffer; p < buffer + n;) {
+            auto event = reinterpret_cast<struct inotify_event *>(p);
+            p += sizeof(struct inotify_event) + event->len;
+
+            if (event->mask & IN_Q_OVERFLOW) {
+                rescanNeeded = true;
+                continue;
+            }
+            if (event->mask & IN_IGNORED) {
+                m_data.watches.remove(event->wd);
+                continue;
+            }
+
+            auto it = m_data.watches.find(event->wd);
+            if (it == m_data.watches.end())
+                continue;
+            quint32 parent = it.value();
+            if (m_data.entries.at(parent).flags & Deleted) {
+                //the folder was moved out of the tree.
+                inotify_rm_watch(m_inotify_fd, event->wd);
+                m_data.watches.erase(it);
+                continue;
+            }
+
+            if (event->mask & (IN_DELETE_SELF | IN_MOVE_SELF)) {
+                //the others are handled by the events of their parents.
+                if (parent == 0)
+                    rescanNeeded = true;
+                continue;
+            }
+            if (event->len == 0)
+                continue;
+
+            QByteArray name = event->name;
+            bool isFolder = event->mask & IN_ISDIR;
+            m_dirty = true;
+
+            if (event->mask & (IN_DELETE | IN_MOVED_FROM)) {
+                auto id = findChild(m_data, parent, name);
+                if (id != INVALID_ID)
+                    removeEntry(id);
+                continue;
+            }
+
+            if (event->mask & (IN_CREATE | IN_MOVED_TO)) {
+                auto id = findChild(m_data, parent, name);
+                if (id != INVALID_ID) {
+                    //the folder has been scanned with its parent.
+                    if (!(event->mask & IN_MOVED_TO) && isFolder == bool(m_data.entries.at(id).flags & Folder))
+                        continue;
+                    removeEntry(id);
+                }
+                id = addEntry(m_data, parent, name, isFolder? Folder: 0);
+                if (!isFolder)
+                    continue;
+
+                auto path = pathOf(m_data, id);
+                struct stat st;
+                if (lstat(path.constData(), &st) != 0 || quint64(st.st_dev) != m_root_device) {
+                    m_data.entries[id].flags |= Unindexed;
+                    continue;
+                }
+                scanFolder(m_data, m_inotify_fd, id, path);
+            }
+        }
+    }
+
+    if (m_data.deleted_count > MAX_DELETED_COUNT && m_data.deleted_count > m_data.entries.count()/2)
+        rescanNeeded = true;
+    locker.unlock();
+
+    if (rescanNeeded && !m_rescan_timer->isActive())
+        m_rescan_timer->start();
+    if (m_dirty && !m_save_timer->isActive())
+        m_save_timer->start();
+}
+
+quint32 SearchFileIndex::addEntry(IndexData &data, quint32 parent, const QByteArray &name, quint32 flags)
+{
+    quint32 id = quint32(data.entries.count());
+    Entry entry;
+    entry.parent = parent;
+    entry.flags = flags;
+    entry.name = name;
+    data.entries.append(entry);
+
+    if (parent != INVALID_ID) {
+        data.children[parent].append(id);
+        //the ids only increase, so that the posting lists are sorted.
+        for (auto key : trigramsOf(QFile::decodeName(name).toLower().toUtf8())) {
+            data.trigrams[key].append(id);
+        }
+    }
+    return id;
+}
+
+quint32 SearchFileIndex::findChild(const IndexData &data, quint32 parent, const QByteArray &name)
+{
+    auto it = data.children.constFind(parent);
+    if (it == data.children.constEnd())
+        return INVALID_ID;
+    for (auto id : it.value()) {
+        auto &entry = data.entries.at(id);
+        if (!(entry.flags & Deleted) && entry.name == name)
+            return id;
+    }
+    return INVALID_ID;
+}
+
+QByteArray SearchFileIndex::pathOf(const IndexData &data, quint32 id)
+{
+    QList<QByteArray> names;
+    while (id != INVALID_ID) {
+        names.prepend(data.entries.at(id).name);
+        id = data.entries.at(id).parent;
+    }
+    //the name of the root entry is the root path.
+    QByteArray path = names.takeFirst();
+    for (auto name : names) {
+        if (!path.endsWith('/'))
+            path.append('/');
+        path.append(name);
+    }
+    return path;
+}
+
+QVector<quint32> SearchFileIndex::trigramsOf(const QByteArray &lowerName)
+{
+    QVector<quint32> keys;
+    for (int i = 0; i + 2 < lowerName.size(); i++) {
+        keys<<(quint32(quint8(lowerName.at(i)))<<16
+               | quint32(quint8(lowerName.at(i + 1)))<<8
+               | quint32(quint8(lowerName.at(i + 2))));
+    }
+    std::sort(keys.begin(), keys.end());
+    keys.erase(std::unique(keys.begin(), keys.end()), keys.end());
+    return keys;
+}
+
+void SearchFileIndex::scanFolder(IndexData &data, int inotifyFd, quint32 id, const QByteArray &path)
+{
+    QVector<QPair<quint32, QByteArray>> stack;
+    stack<<qMakePair(id, path);
+    while (!stack.isEmpty()) {
+        auto folder = stack.takeLast();
+        if (data.watches.count() >= m_max_watch_count) {
+            if (!m_watch_limit_reached) {
+                m_watch_limit_reached = true;
+                qWarning()<<"search index: the inotify watch limit"<<m_max_watch_count
+                         <<"is reached, the other folders will be crawled in searching";
+            }
+            data.entries[folder.first].flags |= Unindexed;
+            continue;
+        }
+        //watch the folder before reading it, so that no change is missed.
+        int wd = inotify_add_watch(inotifyFd, folder.second.constData(), WATCH_MASK);
+        DIR *dir = wd < 0? nullptr: opendir(folder.second.constData());
+        if (!dir) {
+            if (wd >= 0)
+                inotify_rm_watch(inotifyFd, wd);
+            data.entries[folder.first].flags |= Unindexed;
+            continue;
+        }
+        data.watches.insert(wd, folder.first);
+
+        int fd = dirfd(dir);
+        while (auto ent = readdir(dir)) {
+            if (strcmp(ent->d_name, ".") == 0 || strcmp(ent->d_name, "..") == 0)
+                continue;
+
+            struct stat st;
+            bool stated = false;
+            bool isFolder = ent->d_type == DT_DIR;
+            if (ent->d_type == DT_UNKNOWN) {
+                stated = fstatat(fd, ent->d_name, &st, AT_SYMLINK_NOFOLLOW) == 0;
+                isFolder = stated && S_ISDIR(st.st_mode);
+            }
+
+            auto childId = addEntry(data, folder.first, ent->d_name, isFolder? Folder: 0);
+            if (!isFolder)
+                continue;
+
+            if (!stated)
+                stated = fstatat(fd, ent->d_name, &st, AT_SYMLINK_NOFOLLOW) == 0;
+            //do not cross the mount points.
+            if (!stated || quint64(st.st_dev) != m_root_device) {
+                data.entries[childId].flags |= Unindexed;
+                continue;
+            }
+
+            QByteArray childPath = folder.second;
+            if (!childPath.endsWith('/'))
+                childPath.append('/');
+            childPath.append(ent->d_name);
+            stack<<qMakePair(childId, childPath);
+        }
+        closedir(dir);
+    }
+}
+
+void SearchFileIndex::removeEntry(quint32 id)
+{
+    quint32 parent = m_data.entries.at(id).parent;
+    if (parent != INVALID_ID) {
+        auto it = m_data.children.find(parent);
+        if (it != m_data.children.end())
+            it.value().removeOne(id);
+    }
+
+    //the posting lists still contain the deleted entries, they are skipped when searching.
+    QVector<quint32> stack;
+    stack<<id;
+    while (!stack.isEmpty()) {
+        auto current = stack.takeLast();
+        auto &entry = m_data.entries[current];
+        if (entry.flags & Deleted)
+            continue;
+        entry.flags |= Deleted;
+        m_data.deleted_count++;
+        if (entry.flags & Folder)
+            stack += m_data.children.take(current);
+    }
+}
+
+bool SearchFileIndex::load()
+{
+    QFile file(indexFilePath());
+    if (!file.open(QIODevice::ReadOnly))
+        return false;
+
+    QDataStream stream(&file);
+    quint32 magic = 0;
+    quint32 version = 0;
+    QString rootPath;
+    quint32 count = 0;
+    stream>>magic>>version>>rootPath>>count;
+    if (stream.status() != QDataStream::Ok || magic != SEARCH_INDEX_MAGIC
+            || version != SEARCH_INDEX_VERSION || rootPath != m_root_path || count == 0)
+        return false;
+
+    IndexData data;
+    data.entries.reserve(int(count));
+    for (quint32 i = 0; i < count; i++) {
+        quint32 parent = 0;
+        quint32 flags = 0;
+        QByteArray name;
+        stream>>parent>>flags>>name;
+        if (stream.status() != QDataStream::Ok)
+            return false;
+        //only the root has no parent, and a parent is always saved before its children.
+        if ((i == 0) != (parent == INVALID_ID) || (i > 0 && parent >= i))
+            return false;
+        addEntry(data, parent, name, flags);
+    }
+
+    QWriteLocker locker(&m_lock);
+    m_data = data;
+    m_ready = true;
+    m_stale = true;
+    return true;
+}
+
+void SearchFileIndex::setInotifyFd(int fd)
+{
+    if (m_notifier) {
+        m_notifier->setEnabled(false);
+        m_notifier->deleteLater();
+    }
+    if (m_inotify_fd >= 0)
+        close(m_inotify_fd);
+
+    m_inotify_fd = fd;
+    m_notifier = new QSocketNotifier(fd, QSocketNotifier::Read, this);
+    connect(m_notifier, &QSocketNotifier::activated, this, &SearchFileIndex::onInotifyEventsReady);
+}
+
+QString SearchFileIndex::indexFilePath()
+{
+    return QStandardPaths::writableLocation(QStandardPaths::GenericCacheLocation) + "/peony-qt/search-index";
+}
@@ -0,0 +1,179 @@
+/*
+ * Peony-Qt's Library
+ *
+ * Copyright (C) 2020, Tianjin KYLIN Information Technology Co., Ltd.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this library.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * Authors: Yue Lan <lanyue@kylinos.cn>
+ *
+ */
+
+#ifndef SEARCHFILEINDEX_H
+#define SEARCHFILEINDEX_H
+
+#include <QObject>
+#include <QVector>
+#include <QHash>
+#include <QStringList>
+#include <QReadWriteLock>
+
+#include <functional>
+
+//in milliseconds, the index is saved to disk at most once per interval.
+#ifndef PEONY_SEARCH_INDEX_SAVE_INTERVAL
+#define PEONY_SEARCH_INDEX_SAVE_INTERVAL 60000
+#endif
+
+//in milliseconds, the delay of rescanning after the inotify queue overflowed.
+#ifndef PEONY_SEARCH_INDEX_RESCAN_DELAY
+#define PEONY_SEARCH_INDEX_RESCAN_DELAY 60000
+#endif
+
+//the index uses at most 1/ratio of the user's inotify watches, the others
+//are left to the file watchers of peony and the other applications.
+#ifndef PEONY_SEARCH_INDEX_WATCH_RATIO
+#define PEONY_SEARCH_INDEX_WATCH_RATIO 4
+#endif
+
+class QSocketNotifier;
+class QTimer;
+
+namespace Peony {
+
+/*!
+ * \brief The SearchFileIndex class
+ * <br>
+ * A filename index of a local directory tree (the home directory by default),
+ * which is used by search vfs for name searches instead of crawling the tree.
+ * The names are indexed by their trigrams, so searching a literal key only
+ * checks the files whose names contain all the trigrams of the key.
+ * </br>
+ * <br>
+ * The index is kept up to date by inotify watches on every indexed folder.
+ * It uses a part of the user's watches only, see PEONY_SEARCH_INDEX_WATCH_RATIO,
+ * the folders beyond the limit are left unindexed and crawled in searching.
+ * The index is saved in $XDG_CACHE_HOME/peony-qt/search-index. The saved index
+ * is loaded when the index starts, and it is used until the tree has been
+ * rescanned. The results of a loaded index are checked before returned, so
+ * that removed files are not listed, though newly created files might be
+ * missing until the rescan is finished.
+ * </br>
+ * <br>
+ * Folders which could not be watched or read, and the folders on other
+ * devices (mount points) are not indexed. search() reports them, and the
+ * caller should crawl them as before.
+ * </br>
+ * \note The index lives in its own thread, see SearchVFSManager. search() and
+ * isReady() are thread safe.
+ */
+class SearchFileIndex : public QObject
+{
+    Q_OBJECT
+public:
+    explicit SearchFileIndex(const QString &rootPath, QObject *parent = nullptr);
+    ~SearchFileIndex() override;
+
+    /*!
+     * \brief isReady
+     * \return true if the index has been loaded or scanned.
+     */
+    bool isReady();
+
+    /*!
+     * \brief search
+     * \param dirPath, the local path of the searched directory, which is not matched itself.
+     * \param matcher, returns true if a display name matches.
+     * \param literal, a string which every matched name contains, it is used
+     * for the trigram filtering. Empty if there is not such a string.
+     * \param results, the uris of the matched files.
+     * \param uncoveredDirs, the uris of the folders which are not indexed in \a dirPath.
+     * \return false if \a dirPath is not covered by the index, the results are empty then.
+     */
+    bool search(const QString &dirPath,
+                const std::function<bool (const QString &)> &matcher,
+                const QString &literal,
+                QStringList &results,
+                QStringList &uncoveredDirs);
+
+public Q_SLOTS:
+    /*!
+     * \brief start
+     * <br>
+     * Load the saved index, then rescan the tree. It should be called in the
+     * index's thread.
+     * </br>
+     */
+    void start();
+    void save();
+
+private Q_SLOTS:
+    void rescan();
+    void onInotifyEventsReady();
+
+private:
+    enum Flag {
+        Folder = 1,
+        Deleted = 2,
+        Unindexed = 4
+    };
+
+    struct Entry {
+        quint32 parent;
+        quint32 flags;
+        QByteArray name;
+    };
+
+    struct IndexData {
+        QVector<Entry> entries;
+        QHash<quint32, QVector<quint32>> children;
+        QHash<quint32, QVector<quint32>> trigrams;
+        QHash<int, quint32> watches;
+        int deleted_count = 0;
+    };
+
+    static quint32 addEntry(IndexData &data, quint32 parent, const QByteArray &name, quint32 flags);
+    static quint32 findChild(const IndexData &data, quint32 parent, const QByteArray &name);
+    static QByteArray pathOf(const IndexData &data, quint32 id);
+    static QVector<quint32> trigramsOf(const QByteArray &lowerName);
+
+    void scanFolder(IndexData &data, int inotifyFd, quint32 id, const QByteArray &path);
+    void removeEntry(quint32 id);
+    bool load();
+    void setInotifyFd(int fd);
+
+    QString indexFilePath();
+
+    QString m_root_path;
+    quint64 m_root_device = 0;
+
+    QReadWriteLock m_lock;
+    IndexData m_data;
+    bool m_ready = false;
+    //loaded from disk and not rescanned yet.
+    bool m_stale = false;
+    bool m_dirty = false;
+
+    int m_inotify_fd = -1;
+    //the folders beyond the limit are unindexed, and they are crawled in searching.
+    int m_max_watch_count = 0;
+    bool m_watch_limit_reached = false;
+    QSocketNotifier *m_notifier = nullptr;
+    QTimer *m_save_timer = nullptr;
+    QTimer *m_rescan_timer = nullptr;
+};
+
+}
+
+#endif // SEARCHFILEINDEX_H
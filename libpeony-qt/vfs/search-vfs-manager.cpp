@@ -21,6 +21,11 @@
  */
 
 #include "search-vfs-manager.h"
+#include "search-file-index.h"
+#include "global-settings.h"
+
+#include <QThread>
+#include <QDir>
 
 using namespace Peony;
 
@@ -36,12 +41,26 @@ SearchVFSManager *SearchVFSManager::getInstance()
 
 SearchVFSManager::SearchVFSManager(QObject *parent) : QObject(parent)
 {
-
+    auto settings = GlobalSettings::getInstance();
+    if (settings->isExist(SEARCH_FILE_INDEX) && settings->getValue(SEARCH_FILE_INDEX).toBool()) {
+        //the index is scanned and updated in its own thread.
+        m_index_thread = new QThread(this);
+        m_file_index = new SearchFileIndex(QDir::homePath());
+        m_file_index->moveToThread(m_index_thread);
+        connect(m_index_thread, &QThread::started, m_file_index, &SearchFileIndex::start);
+        connect(m_index_thread, &QThread::finished, m_file_index, &SearchFileIndex::deleteLater);
+        m_index_thread->start(QThread::LowestPriority);
+    }
 }
 
 SearchVFSManager::~SearchVFSManager()
 {
     m_search_dir_results_hash.clear();
+    if (m_index_thread) {
+        QMetaObject::invokeMethod(m_file_index, "save", Qt::BlockingQueuedConnection);
+        m_index_thread->quit();
+        m_index_thread->wait();
+    }
 }
 
 void SearchVFSManager::clearHistory()
@@ -60,17 +79,42 @@ void SearchVFSManager::clearHistoryOne(const QString &searchUri)
 
 bool SearchVFSManager::hasHistory(const QString &searchUri)
 {
+    QMutexLocker locker(&m_mutex);
     return m_search_dir_results_hash.contains(searchUri);
 }
 
 void SearchVFSManager::addHistory(const QString &searchUri, const QStringList &results)
 {
+    //build the compact history out of the lock.
+    auto history = std::make_shared<const SearchHistory>(results);
     m_mutex.lock();
-    m_search_dir_results_hash.insert(searchUri, results);
+    m_search_dir_results_hash.insert(searchUri, history);
     m_mutex.unlock();
 }
 
-QStringList SearchVFSManager::getHistroyResults(const QString &searchUri)
+std::shared_ptr<const SearchHistory> SearchVFSManager::getHistroyResults(const QString &searchUri)
 {
+    QMutexLocker locker(&m_mutex);
     return m_search_dir_results_hash.value(searchUri);
 }
+
+SearchHistory::SearchHistory(const QStringList &uris)
+{
+    int size = 0;
+    for (auto uri : uris) {
+        size += uri.size() + 1;
+    }
+    m_data.reserve(size);
+    m_offsets.reserve(uris.count());
+    for (auto uri : uris) {
+        m_offsets<<m_data.size();
+        m_data.append(uri.toUtf8());
+        m_data.append('\0');
+    }
+    m_data.squeeze();
+}
+
+QString SearchHistory::uriAt(int index) const
+{
+    return QString::fromUtf8(m_data.constData() + m_offsets.at(index));
+}
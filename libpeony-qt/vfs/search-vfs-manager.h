@@ -26,15 +26,52 @@
 #include <QObject>
 #include <QHash>
 #include <QMutex>
+#include <QVector>
+#include <QByteArray>
+
+#include <memory>
+
+class QThread;
 
 namespace Peony {
 
+class SearchFileIndex;
+
+/*!
+ * \brief The SearchHistory class
+ * <br>
+ * The results of a finished search, in the ranked order. All uris are kept
+ * in one UTF-8 buffer instead of a QStringList of separated strings. A history
+ * is immutable, and the enumerators reading it share it with the manager.
+ * </br>
+ */
+class SearchHistory
+{
+public:
+    explicit SearchHistory(const QStringList &uris);
+
+    int count() const {return m_offsets.count();}
+    QString uriAt(int index) const;
+
+private:
+    //NUL terminated uris.
+    QByteArray m_data;
+    QVector<int> m_offsets;
+};
+
 class SearchVFSManager : public QObject
 {
     Q_OBJECT
 public:
     static SearchVFSManager *getInstance();
 
+    /*!
+     * \brief fileIndex
+     * \return the filename index of the home directory, or nullptr if the
+     * index is disabled by the global settings (SEARCH_FILE_INDEX).
+     */
+    SearchFileIndex *fileIndex() {return m_file_index;}
+
 public Q_SLOTS:
     void clearHistory();
     /*!
@@ -47,14 +84,21 @@ public Q_SLOTS:
     void clearHistoryOne(const QString &searchUri);
     void addHistory(const QString &searchUri, const QStringList &results);
     bool hasHistory(const QString &serachUri);
-    QStringList getHistroyResults(const QString &searchUri) ;
+    /*!
+     * \brief getHistroyResults
+     * \return the shared history of \a searchUri, or nullptr if there is none.
+     */
+    std::shared_ptr<const SearchHistory> getHistroyResults(const QString &searchUri);
 
 private:
     explicit SearchVFSManager(QObject *parent = nullptr);
     ~SearchVFSManager();
 
     QMutex m_mutex;
-    QHash<QString, QStringList> m_search_dir_results_hash;
+    QHash<QString, std::shared_ptr<const SearchHistory>> m_search_dir_results_hash;
+
+    SearchFileIndex *m_file_index = nullptr;
+    QThread *m_index_thread = nullptr;
 };
 
 }
@@ -5,10 +5,16 @@ HEADERS += $$PWD/peony-search-vfs-file.h \
            $$PWD/peony-search-vfs-file-enumerator.h \
            $$PWD/search-vfs-register.h \
     $$PWD/search-vfs-manager.h \
-    $$PWD/search-vfs-uri-parser.h
+    $$PWD/search-vfs-uri-parser.h \
+    $$PWD/search-file-index.h \
+    $$PWD/search-crawler.h \
+    $$PWD/search-content-matcher.h
 
 SOURCES += $$PWD/peony-search-vfs-file.cpp \
            $$PWD/peony-search-vfs-file-enumerator.cpp \
            $$PWD/search-vfs-register.cpp \
     $$PWD/search-vfs-manager.cpp \
-    $$PWD/search-vfs-uri-parser.cpp
+    $$PWD/search-vfs-uri-parser.cpp \
+    $$PWD/search-file-index.cpp \
+    $$PWD/search-crawler.cpp \
+    $$PWD/search-content-matcher.cpp
@@ -60,6 +60,15 @@ DesktopItemModel::DesktopItemModel(QObject *parent)
             }
         }
     });
+    auto onThumbnailUpdated = [=](const QString &uri){
+        for (auto info : m_files) {
+            if (info->uri() == uri) {
+                auto index = indexFromUri(uri);
+                Q_EMIT this->dataChanged(index, index, QVector<int>()<<Qt::DecorationRole);
+            }
+        }
+    };
+    connect(m_thumbnail_watcher.get(), &FileWatcher::thumbnailUpdated, this, onThumbnailUpdated);
 
     m_trash_watcher = std::make_shared<FileWatcher>("trash:///", this);
 
@@ -91,6 +100,8 @@ DesktopItemModel::DesktopItemModel(QObject *parent)
 
     m_desktop_watcher = std::make_shared<FileWatcher>("file://" + QStandardPaths::writableLocation(QStandardPaths::DesktopLocation), this);
     m_desktop_watcher->setMonitorChildrenChange(true);
+    //the thumbnails of desktop files are requested with this watcher.
+    connect(m_desktop_watcher.get(), &FileWatcher::thumbnailUpdated, this, onThumbnailUpdated);
     this->connect(m_desktop_watcher.get(), &FileWatcher::fileCreated, [=](const QString &uri){
         //qDebug()<<"created"<<uri;
         auto info = FileInfo::fromUri(uri, true);
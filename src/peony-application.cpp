@@ -443,8 +443,8 @@ PeonyApplication::PeonyApplication(int &argc, char *argv[], const char *applicat
     auto op = new Peony::FileCountOperation(l);
     QThreadPool::globalInstance()->start(op);
 
-    connect(op, &Peony::FileCountOperation::operationPreparedOne, [=](const QString &uri){
-        qDebug()<<uri;
+    connect(op, &Peony::FileCountOperation::countProgressed, [=](quint64 file_count, quint64 hidden_file_count, quint64 total_size){
+        qDebug()<<file_count<<hidden_file_count<<total_size;
     });
 
     connect(op, &Peony::FileCountOperation::operationFinished, [=](){